@@ -0,0 +1,229 @@
+//============================================================================
+// Name			: Animation Sink (AnimationSink.h)
+// Description 	: Treats each row of icons as the frames of an animation and
+//				: writes, for each frame, only the lines that differ from the
+//				: frame before as Sharp Memory LCD line update commands
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _ANIMATION_SINK_LIB_H
+#define _ANIMATION_SINK_LIB_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <stdint.h>
+
+#include "IconSink.h"
+
+// Class for writing animations for line addressed partial refresh. Consecutive frames of a sequence
+// are XORed a line at a time and only the lines that changed are written. The first frame of each
+// sequence is written in full. Every frame of a sequence must have the same dimensions (see --samesize).
+//
+// File layout, all values little endian:
+//   Header, 16 bytes:   "IANM", uint32 version, uint32 number of sequences, uint32 reserved
+//   Each sequence:      uint32 number of frames, uint32 width, uint32 height, then each frame:
+//     uint16 number of changed lines, uint16 line numbers (1 for the top line),
+//     uint32 length of the command, then the Sharp Memory LCD write command updating those lines:
+//     mode byte 0x80, then for each line its address byte, the line data and a 0x00 dummy byte,
+//     then a final 0x00. Bytes are in the order they are sent, most significant bit first, so the
+//     address bits are reversed, as the panel reads addresses least significant bit first.
+// The commands address lines from the top of the panel and send whole lines, so they can be sent as
+// they are when the frames are as wide as the panel. Otherwise the line numbers say which lines of
+// the application's frame buffer to send.
+class AnimationSink : public IconSink {
+
+private:
+	const std::string path;
+	const std::vector<uint32_t> sequences;		// sequence number of each icon
+	std::vector<uint8_t> animation;
+	std::vector<uint8_t> previousFrame;
+	uint64_t framePosition;						// position in animation of the current sequence's frame count
+	uint32_t currentSequence;
+	uint32_t numSequences;
+	uint32_t numFrames;
+	uint32_t frameWidth;
+	uint32_t frameHeight;
+	uint64_t fullFrameBytes;
+	uint64_t changedLineBytes;
+
+	AnimationSink(const AnimationSink &);
+	AnimationSink & operator=(const AnimationSink &);
+
+	void append(const void * data, uint64_t numBytes) {
+		animation.insert(animation.end(), (const uint8_t *)data, (const uint8_t *)data + numBytes);
+	}
+
+
+	// Does a line differ between two frames? Compared a word at a time
+	static bool lineChanged(const uint8_t * line, const uint8_t * previousLine, uint32_t numBytes) {
+		uint64_t difference = 0;
+		uint32_t byte = 0;
+		for(; byte + sizeof(uint64_t) <= numBytes; byte += sizeof(uint64_t)) {
+			uint64_t word = 0;
+			uint64_t previousWord = 0;
+			memcpy(&word, line + byte, sizeof(uint64_t));
+			memcpy(&previousWord, previousLine + byte, sizeof(uint64_t));
+			difference |= word ^ previousWord;
+		}
+		for(; byte < numBytes; byte++) {
+			difference |= line[byte] ^ previousLine[byte];
+		}
+		return difference != 0;
+	}
+
+
+	static uint8_t reverseBits(uint8_t byte) {
+		byte = (byte >> 4) | (byte << 4);
+		byte = ((byte & 0xCC) >> 2) | ((byte & 0x33) << 2);
+		return ((byte & 0xAA) >> 1) | ((byte & 0x55) << 1);
+	}
+
+
+	// Size of the animation if every line of every frame changes: the dimensions starting a sequence, the
+	// changed line numbers and the command with every line in it
+	static uint64_t maxAnimationBytes(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) {
+		uint64_t numBytes = 16;
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			const uint64_t bytesInIconRow = (iconWidths[i] + 7) / 8;
+			numBytes += (3 * sizeof(uint32_t)) + sizeof(uint16_t) + sizeof(uint32_t) + 2 + ((uint64_t)iconHeights[i] * (bytesInIconRow + 4));
+		}
+		return numBytes;
+	}
+
+
+	void endSequence() {
+		if(numSequences > 0) {
+			memcpy(&animation[framePosition], &numFrames, sizeof(uint32_t));
+		}
+	}
+
+public:
+	static const uint32_t version = 1;
+
+	// Constructor. iconSequences gives the sequence each icon belongs to, in icon order
+	AnimationSink(const std::string & animationPath, const std::vector<uint32_t> & iconSequences) : path(animationPath),
+		sequences(iconSequences), framePosition(0), currentSequence(0), numSequences(0), numFrames(0), frameWidth(0),
+		frameHeight(0), fullFrameBytes(0), changedLineBytes(0) {
+		animation.resize(16, 0);
+		memcpy(&animation[0], "IANM", 4);
+		memcpy(&animation[4], &version, sizeof(uint32_t));
+	}
+
+
+	// Reserved for the largest animation the frames can make, so that it is never copied as it grows
+	bool begin(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) {
+		animation.reserve(maxAnimationBytes(iconWidths, iconHeights));
+		return true;
+	}
+
+
+	bool writeIcon(uint32_t icon, const std::string & /*name*/, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		const uint32_t bytesInIconRow = (iconWidth + 7) / 8;
+		const bool firstFrame = (numSequences == 0) || (sequences[icon] != currentSequence);
+		if(firstFrame) {
+			// Line addresses are a single byte
+			if(iconHeight > 255) {
+				return false;
+			}
+			endSequence();
+			currentSequence = sequences[icon];
+			numSequences++;
+			numFrames = 0;
+			frameWidth = iconWidth;
+			frameHeight = iconHeight;
+			framePosition = animation.size();
+			const uint32_t dimensions[3] = {0, iconWidth, iconHeight};
+			append(dimensions, sizeof(dimensions));
+		}
+		else if(iconWidth != frameWidth || iconHeight != frameHeight) {
+			return false;
+		}
+
+		std::vector<uint16_t> changedLines;
+		for(uint32_t line = 0; line < iconHeight; line++) {
+			const uint8_t * lineData = iconData + ((uint64_t)line * bytesInIconRow);
+			if(firstFrame || lineChanged(lineData, &previousFrame[(uint64_t)line * bytesInIconRow], bytesInIconRow)) {
+				changedLines.push_back(line + 1);
+			}
+		}
+		const uint16_t numChangedLines = changedLines.size();
+		const uint32_t commandLength = changedLines.empty() ? 0 : 2 + (changedLines.size() * (bytesInIconRow + 2));
+		append(&numChangedLines, sizeof(uint16_t));
+		append(changedLines.data(), changedLines.size() * sizeof(uint16_t));
+		append(&commandLength, sizeof(uint32_t));
+		if(!changedLines.empty()) {
+			animation.push_back(0x80);
+			for(unsigned int i = 0; i < changedLines.size(); i++) {
+				animation.push_back(reverseBits((uint8_t)changedLines[i]));
+				append(iconData + ((uint64_t)(changedLines[i] - 1) * bytesInIconRow), bytesInIconRow);
+				animation.push_back(0x00);
+			}
+			animation.push_back(0x00);
+		}
+		previousFrame.assign(iconData, iconData + ((uint64_t)bytesInIconRow * iconHeight));
+		numFrames++;
+		fullFrameBytes += 2 + (iconHeight * (bytesInIconRow + 2));
+		changedLineBytes += commandLength;
+		return true;
+	}
+
+
+	bool finish() {
+		endSequence();
+		memcpy(&animation[8], &numSequences, sizeof(uint32_t));
+		std::ofstream file(path.c_str(), (std::ofstream::out | std::ofstream::binary | std::ofstream::trunc));
+		file.write((const char *)animation.data(), animation.size());
+		file.close();
+		return !file.fail();
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return "frame " + name + " of " + path;
+	}
+
+
+	// The animation and the previous frame with its changed lines
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		uint64_t largestFrameBytes = 0;
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			largestFrameBytes = std::max(largestFrameBytes, (uint64_t)(((iconWidths[i] + 7) / 8) + sizeof(uint16_t)) * iconHeights[i]);
+		}
+		return maxAnimationBytes(iconWidths, iconHeights) + largestFrameBytes + ((uint64_t)sequences.size() * sizeof(uint32_t));
+	}
+
+
+	// Bytes of LCD commands needed to send every frame in full
+	uint64_t sizeOfFullFrames() const {
+		return fullFrameBytes;
+	}
+
+
+	// Bytes of LCD commands needed to send only the changed lines
+	uint64_t sizeOfChangedLines() const {
+		return changedLineBytes;
+	}
+
+};
+#endif
@@ -0,0 +1,195 @@
+//============================================================================
+// Name			: Atlas Sink (AtlasSink.h)
+// Description 	: Writes every icon into a single atlas file: a small header,
+//				: an index of icon positions and dimensions, then the icons'
+//				: pixel data. The file is sized from the icon dimensions before
+//				: any icon is extracted and is written through a shared mapping.
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _ATLAS_SINK_LIB_H
+#define _ATLAS_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <errno.h>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "IconSink.h"
+
+// Atlas file layout, all values little endian:
+//   Header, 16 bytes:        "IATL", uint32 version, uint32 number of icons, uint32 flags
+//   Index, 16 bytes per icon: uint64 offset of pixel data from start of file, uint32 width, uint32 height
+//   Pixel data:              each icon's rows from top to bottom, ceil(width/8) bytes per row,
+//                            most significant bit first, 0 for black and 1 for white
+// Flag bit 0 is set when the bytes of pixel data are least significant bit first instead.
+class AtlasSink : public IconSink {
+
+private:
+	const std::string path;
+	const uint32_t flags;
+	int fd;
+	uint8_t * mapping;
+	uint64_t mappedBytes;
+	std::vector<uint64_t> slotOffsets;
+
+	AtlasSink(const AtlasSink &);
+	AtlasSink & operator=(const AtlasSink &);
+
+	void release() {
+		if(mapping != NULL) {
+			munmap(mapping, mappedBytes);
+			mapping = NULL;
+		}
+		if(fd >= 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+
+public:
+	static const uint32_t headerSize = 16;
+	static const uint32_t indexEntrySize = 16;
+	static const uint32_t version = 1;
+	static const uint32_t leastSignificantBitFirst = 1;
+
+	// Constructor. Creates, or truncates, the atlas file. The pixel data handed to it is least significant
+	// bit first if lsbFirst is true, which is recorded in the header
+	AtlasSink(const std::string & atlasPath, bool lsbFirst) : path(atlasPath), flags(lsbFirst ? leastSignificantBitFirst : 0),
+		mapping(NULL), mappedBytes(0) {
+		fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	}
+
+
+	~AtlasSink() {
+		release();
+	}
+
+
+	bool isOpen() const {
+		return fd >= 0;
+	}
+
+
+	// Number of bytes of pixel data for one icon
+	static uint64_t bytesForIcon(uint32_t width, uint32_t height) {
+		return (uint64_t)((width + 7) / 8) * height;
+	}
+
+
+	// Lays out the atlas for icons of the given dimensions, preallocates the file and maps it.
+	// Each icon's slot starts where the slots of the icons before it end.
+	bool layout(const std::vector<uint32_t> & widths, const std::vector<uint32_t> & heights) {
+		const uint32_t numIcons = widths.size();
+		slotOffsets.resize(numIcons);
+		uint64_t totalBytes = headerSize + ((uint64_t)numIcons * indexEntrySize);
+		for(uint32_t i = 0; i < numIcons; i++) {
+			slotOffsets[i] = totalBytes;
+			totalBytes += bytesForIcon(widths[i], heights[i]);
+		}
+		// Reserve the blocks up front so that the workers filling the mapping never extend the file
+		if(fallocate(fd, 0, 0, totalBytes) != 0) {
+			if((errno != EOPNOTSUPP && errno != ENOSYS) || ftruncate(fd, totalBytes) != 0) {
+				return false;
+			}
+		}
+		void * result = mmap(NULL, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(result == MAP_FAILED) {
+			return false;
+		}
+		mapping = (uint8_t *)result;
+		mappedBytes = totalBytes;
+
+		memcpy(mapping, "IATL", 4);
+		memcpy(mapping + 4, &version, sizeof(uint32_t));
+		memcpy(mapping + 8, &numIcons, sizeof(uint32_t));
+		memcpy(mapping + 12, &flags, sizeof(uint32_t));
+		for(uint32_t i = 0; i < numIcons; i++) {
+			uint8_t * entry = mapping + headerSize + ((uint64_t)i * indexEntrySize);
+			memcpy(entry, &slotOffsets[i], sizeof(uint64_t));
+			memcpy(entry + 8, &widths[i], sizeof(uint32_t));
+			memcpy(entry + 12, &heights[i], sizeof(uint32_t));
+		}
+		return true;
+	}
+
+
+	bool begin(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) {
+		return layout(iconWidths, iconHeights);
+	}
+
+
+	// Copies an icon extracted elsewhere into its slot
+	bool writeIcon(uint32_t icon, const std::string & /*name*/, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		memcpy(slot(icon), iconData, bytesForIcon(iconWidth, iconHeight));
+		return true;
+	}
+
+
+	// Start of the pixel data of an icon within the mapping. Different icons' slots can be
+	// filled at the same time from different threads.
+	uint8_t * slot(uint32_t icon) {
+		return mapping + slotOffsets[icon];
+	}
+
+
+	// Size of the atlas file in bytes
+	uint64_t sizeInBytes() const {
+		return mappedBytes;
+	}
+
+
+	// Unmaps and closes the atlas. The kernel writes the dirty pages back to the file.
+	bool finish() {
+		bool success = (mapping != NULL);
+		if(mapping != NULL && munmap(mapping, mappedBytes) != 0) {
+			success = false;
+		}
+		mapping = NULL;
+		if(fd >= 0 && close(fd) != 0) {
+			success = false;
+		}
+		fd = -1;
+		return success;
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return "icon " + name + " of " + path;
+	}
+
+
+	// The pages of the mapping that have been written stay resident until they are unmapped
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		uint64_t numBytes = headerSize + ((uint64_t)iconWidths.size() * (indexEntrySize + sizeof(uint64_t)));
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			numBytes += bytesForIcon(iconWidths[i], iconHeights[i]);
+		}
+		return numBytes;
+	}
+
+};
+#endif
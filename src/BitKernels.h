@@ -0,0 +1,222 @@
+//============================================================================
+// Name			: Bit Kernels (BitKernels.h)
+// Description 	: Word-at-a-time operations on one-bit-per-pixel images: bit
+//				: reversal, mirroring, 8x8 bit matrix transposes, rotation by
+//				: quarter turns, integer upscaling and bit interleaving
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _BIT_KERNELS_LIB_H
+#define _BIT_KERNELS_LIB_H
+
+#include <cstring>
+#include <stdint.h>
+
+// Images are held as everywhere else in the program: ceil(width/8) bytes per row from top to bottom,
+// most significant bit first, with the padding bits at the end of each row set to 1 (white).
+namespace BitKernels {
+
+	// Reverses the order of the bits in a byte
+	inline uint8_t reverseBits(uint8_t byte) {
+		static const struct lookupTable {
+			uint8_t entries[256];
+			lookupTable() {
+				for(unsigned int value = 0; value < 256; value++) {
+					uint8_t reversed = 0;
+					for(int bit = 0; bit < 8; bit++) {
+						reversed |= ((value >> bit) & 1) << (7 - bit);
+					}
+					entries[value] = reversed;
+				}
+			}
+		} table;
+		return table.entries[byte];
+	}
+
+
+	// Transposes an 8x8 bit matrix held with row 0 in the most significant byte and column 0 in the most
+	// significant bit of each byte, so that row n becomes column n (Hacker's Delight, transpose8)
+	inline uint64_t transpose8(uint64_t x) {
+		uint64_t t;
+		t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+		x = x ^ t ^ (t << 7);
+		t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+		x = x ^ t ^ (t << 14);
+		t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+		x = x ^ t ^ (t << 28);
+		return x;
+	}
+
+
+	// Writes a row of pixels in reverse order: bytes in reverse order, each with its bits reversed. That
+	// moves the padding bits to the start of the row, so the row is shifted left over them as it is written
+	inline void reverseRow(const uint8_t * row, uint32_t bytesPerRow, uint32_t paddingBits, uint8_t * reversedRow) {
+		for(uint32_t byte = 0; byte < bytesPerRow; byte++) {
+			const uint8_t reversed = reverseBits(row[bytesPerRow - 1 - byte]);
+			if(paddingBits == 0) {
+				reversedRow[byte] = reversed;
+				continue;
+			}
+			const uint8_t next = (byte + 1 < bytesPerRow) ? reverseBits(row[bytesPerRow - 2 - byte]) : 0xFF;
+			reversedRow[byte] = (uint8_t)((reversed << paddingBits) | (next >> (8 - paddingBits)));
+		}
+	}
+
+
+	// Writes an image flipped left to right into mirrored
+	inline void mirror(const uint8_t * image, uint32_t width, uint32_t height, uint8_t * mirrored) {
+		const uint32_t bytesPerRow = (width + 7) / 8;
+		for(uint32_t row = 0; row < height; row++) {
+			reverseRow(image + ((uint64_t)row * bytesPerRow), bytesPerRow, (8 * bytesPerRow) - width, mirrored + ((uint64_t)row * bytesPerRow));
+		}
+	}
+
+
+	// Reverses the bits of every byte, turning most significant bit first data into least significant bit
+	// first. The padding bits at the end of each row end up at the top of the last byte, still set.
+	inline void reverseBitOrder(const uint8_t * data, uint64_t numBytes, uint8_t * reversed) {
+		for(uint64_t byte = 0; byte < numBytes; byte++) {
+			reversed[byte] = reverseBits(data[byte]);
+		}
+	}
+
+
+	// Repeats each bit of a byte factor times (1 to 8), most significant first, giving factor bytes in the
+	// low bits of the result. Doubling and tripling, the common cases, are looked up in tables.
+	inline uint64_t spreadBits(uint8_t byte, unsigned int factor) {
+		static const struct lookupTables {
+			uint16_t doubled[256];
+			uint32_t tripled[256];
+			lookupTables() {
+				for(unsigned int value = 0; value < 256; value++) {
+					doubled[value] = 0;
+					tripled[value] = 0;
+					for(int bit = 7; bit >= 0; bit--) {
+						const unsigned int pixel = (value >> bit) & 1;
+						doubled[value] = (uint16_t)((doubled[value] << 2) | (pixel * 0x3));
+						tripled[value] = (tripled[value] << 3) | (pixel * 0x7);
+					}
+				}
+			}
+		} tables;
+		if(factor == 2) {
+			return tables.doubled[byte];
+		}
+		if(factor == 3) {
+			return tables.tripled[byte];
+		}
+		const uint64_t ones = (factor == 8) ? 0xFF : ((1u << factor) - 1);
+		uint64_t spread = 0;
+		for(int bit = 7; bit >= 0; bit--) {
+			spread = (spread << factor) | (((byte >> bit) & 1) * ones);
+		}
+		return spread;
+	}
+
+
+	// Writes an image enlarged by a whole number factor (1 to 8), each pixel becoming a factor by factor
+	// square. Each source byte spreads to exactly factor bytes of the scaled row, so the row is assembled a
+	// byte at a time, and its padding comes from the spread padding bits. The row is then repeated.
+	inline void scale(const uint8_t * image, uint32_t width, uint32_t height, unsigned int factor, uint8_t * scaled) {
+		const uint32_t bytesPerRow = (width + 7) / 8;
+		const uint32_t scaledBytesPerRow = ((width * factor) + 7) / 8;
+		for(uint32_t row = 0; row < height; row++) {
+			const uint8_t * source = image + ((uint64_t)row * bytesPerRow);
+			uint8_t * scaledRow = scaled + ((uint64_t)row * factor * scaledBytesPerRow);
+			uint32_t scaledByte = 0;
+			for(uint32_t byte = 0; byte < bytesPerRow; byte++) {
+				const uint64_t spread = spreadBits(source[byte], factor);
+				for(int part = factor - 1; part >= 0 && scaledByte < scaledBytesPerRow; part--) {
+					scaledRow[scaledByte++] = (uint8_t)(spread >> (8 * part));
+				}
+			}
+			for(unsigned int copy = 1; copy < factor; copy++) {
+				memcpy(scaledRow + ((uint64_t)copy * scaledBytesPerRow), scaledRow, scaledBytesPerRow);
+			}
+		}
+	}
+
+
+	// Interleaves the bits of two bytes, most significant first: bit n of high becomes bit 2n+1 of the result
+	// and bit n of low bit 2n. Each pair of bits is then one two bit pixel with high as its upper bit.
+	inline uint16_t interleaveBits(uint8_t high, uint8_t low) {
+		uint32_t spreadHigh = high;
+		uint32_t spreadLow = low;
+		spreadHigh = (spreadHigh | (spreadHigh << 4)) & 0x0F0F;
+		spreadHigh = (spreadHigh | (spreadHigh << 2)) & 0x3333;
+		spreadHigh = (spreadHigh | (spreadHigh << 1)) & 0x5555;
+		spreadLow = (spreadLow | (spreadLow << 4)) & 0x0F0F;
+		spreadLow = (spreadLow | (spreadLow << 2)) & 0x3333;
+		spreadLow = (spreadLow | (spreadLow << 1)) & 0x5555;
+		return (uint16_t)((spreadHigh << 1) | spreadLow);
+	}
+
+
+	// Gathers the bytes at one byte column of eight consecutive rows into an 8x8 matrix. Rows from
+	// firstRow counting up (step 1) or down (step -1) that fall outside the image are white.
+	inline uint64_t gatherTile(const uint8_t * image, uint32_t bytesPerRow, uint32_t height, int64_t firstRow, int step, uint32_t byteColumn) {
+		uint64_t tile = 0;
+		for(int i = 0; i < 8; i++) {
+			const int64_t row = firstRow + (step * i);
+			const uint8_t byte = (row >= 0 && row < (int64_t)height) ? image[((uint64_t)row * bytesPerRow) + byteColumn] : 0xFF;
+			tile = (tile << 8) | byte;
+		}
+		return tile;
+	}
+
+
+	// Writes an image turned clockwise by a number of quarter turns (0 to 3) into rotated, which must have
+	// room for it. Turning by one or three quarters swaps the width and height. Quarter turns work on 8x8
+	// tiles: eight source rows are transposed together so that each byte of the result is a whole byte of
+	// a rotated row, and the rows are gathered in the order that puts the bits the right way round.
+	inline void rotate(const uint8_t * image, uint32_t width, uint32_t height, unsigned int quarterTurns, uint8_t * rotated) {
+		const uint32_t bytesPerRow = (width + 7) / 8;
+		if(quarterTurns == 1 || quarterTurns == 3) {
+			// The rotated image is height pixels wide. Tile t supplies its byte column t
+			const uint32_t rotatedBytesPerRow = (height + 7) / 8;
+			for(uint32_t tileColumn = 0; tileColumn < rotatedBytesPerRow; tileColumn++) {
+				// Clockwise, rotated column c comes from source row height-1-c. Anticlockwise, from source row c
+				const int64_t firstRow = (quarterTurns == 1) ? ((int64_t)height - 1 - (8 * (int64_t)tileColumn)) : (8 * (int64_t)tileColumn);
+				const int step = (quarterTurns == 1) ? -1 : 1;
+				for(uint32_t byteColumn = 0; byteColumn < bytesPerRow; byteColumn++) {
+					const uint64_t tile = transpose8(gatherTile(image, bytesPerRow, height, firstRow, step, byteColumn));
+					// Byte i of the transposed tile is source column 8*byteColumn+i. Columns in the padding are dropped
+					for(uint32_t i = 0; i < 8 && (8 * byteColumn) + i < width; i++) {
+						const uint32_t sourceColumn = (8 * byteColumn) + i;
+						const uint32_t rotatedRow = (quarterTurns == 1) ? sourceColumn : (width - 1 - sourceColumn);
+						rotated[((uint64_t)rotatedRow * rotatedBytesPerRow) + tileColumn] = (uint8_t)(tile >> (8 * (7 - i)));
+					}
+				}
+			}
+		}
+		else if(quarterTurns == 2) {
+			// Each row is reversed into the opposite row
+			for(uint32_t row = 0; row < height; row++) {
+				reverseRow(image + ((uint64_t)row * bytesPerRow), bytesPerRow, (8 * bytesPerRow) - width, rotated + ((uint64_t)(height - 1 - row) * bytesPerRow));
+			}
+		}
+		else {
+			memcpy(rotated, image, (uint64_t)bytesPerRow * height);
+		}
+	}
+
+}
+#endif
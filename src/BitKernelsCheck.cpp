@@ -0,0 +1,226 @@
+//============================================================================
+// Name			: Bit Kernels Check (BitKernelsCheck.cpp)
+// Description 	: Checks the rotation, mirroring and scaling kernels of
+//				: BitKernels.h against pixel by pixel reference versions on
+//				: random icons, then times both on a sheet's worth of icons.
+//
+// Notes		: Separate from the extractor. Build and run with
+//				: g++ -std=c++11 -O2 -o BitKernelsCheck BitKernelsCheck.cpp
+//				: ./BitKernelsCheck
+//				: Exits with a non-zero status if any kernel disagrees.
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "BitKernels.h"
+
+// Number of random icons each kernel is checked on, and the largest width and height of them
+static const unsigned int numChecks = 3000;
+static const uint32_t maxCheckedSize = 40;
+
+// The timings are of this many icons of this size, about as many as a large sheet holds
+static const unsigned int numTimedIcons = 5000;
+static const uint32_t timedSize = 30;
+
+// Any bytes a kernel writes beyond the end of its image show up as a difference in this filler
+static const uint8_t filler = 0x55;
+
+
+static bool isInk(const uint8_t * image, uint32_t width, uint32_t x, uint32_t y) {
+	return ((image[((uint64_t)y * ((width + 7) / 8)) + (x / 8)] >> (7 - (x % 8))) & 1) == 0;
+}
+
+
+static void setInk(uint8_t * image, uint32_t width, uint32_t x, uint32_t y) {
+	image[((uint64_t)y * ((width + 7) / 8)) + (x / 8)] &= ~(0x80 >> (x % 8));
+}
+
+
+// Turns an image clockwise one pixel at a time
+static void referenceRotate(const uint8_t * image, uint32_t width, uint32_t height, unsigned int quarterTurns, uint8_t * rotated) {
+	const uint32_t rotatedWidth = (quarterTurns % 2 == 1) ? height : width;
+	const uint32_t rotatedHeight = (quarterTurns % 2 == 1) ? width : height;
+	memset(rotated, 0xFF, (uint64_t)((rotatedWidth + 7) / 8) * rotatedHeight);
+	for(uint32_t y = 0; y < height; y++) {
+		for(uint32_t x = 0; x < width; x++) {
+			if(!isInk(image, width, x, y)) {
+				continue;
+			}
+			switch(quarterTurns) {
+				case 0:  setInk(rotated, rotatedWidth, x, y); break;
+				case 1:  setInk(rotated, rotatedWidth, height - 1 - y, x); break;
+				case 2:  setInk(rotated, rotatedWidth, width - 1 - x, height - 1 - y); break;
+				default: setInk(rotated, rotatedWidth, y, width - 1 - x); break;
+			}
+		}
+	}
+}
+
+
+// Flips an image left to right one pixel at a time
+static void referenceMirror(const uint8_t * image, uint32_t width, uint32_t height, uint8_t * mirrored) {
+	memset(mirrored, 0xFF, (uint64_t)((width + 7) / 8) * height);
+	for(uint32_t y = 0; y < height; y++) {
+		for(uint32_t x = 0; x < width; x++) {
+			if(isInk(image, width, x, y)) {
+				setInk(mirrored, width, width - 1 - x, y);
+			}
+		}
+	}
+}
+
+
+// Enlarges an image one pixel at a time
+static void referenceScale(const uint8_t * image, uint32_t width, uint32_t height, unsigned int factor, uint8_t * scaled) {
+	const uint32_t scaledWidth = width * factor;
+	memset(scaled, 0xFF, (uint64_t)((scaledWidth + 7) / 8) * height * factor);
+	for(uint32_t y = 0; y < height * factor; y++) {
+		for(uint32_t x = 0; x < scaledWidth; x++) {
+			if(isInk(image, width, x / factor, y / factor)) {
+				setInk(scaled, scaledWidth, x, y);
+			}
+		}
+	}
+}
+
+
+// Fills an image with random pixels, with the padding bits at the end of each row set as the kernels expect
+static void randomImage(uint32_t width, uint32_t height, std::vector<uint8_t> & image) {
+	const uint32_t bytesPerRow = (width + 7) / 8;
+	image.resize((uint64_t)bytesPerRow * height);
+	for(uint64_t byte = 0; byte < image.size(); byte++) {
+		image[byte] = (uint8_t)rand();
+	}
+	for(uint32_t y = 0; y < height && (width % 8) != 0; y++) {
+		image[((uint64_t)y * bytesPerRow) + bytesPerRow - 1] |= (1 << (8 - (width % 8))) - 1;
+	}
+}
+
+
+static bool reportMismatch(const char * kernel, uint32_t width, uint32_t height, unsigned int parameter) {
+	std::cout << "ERROR: " << kernel << " differs from the reference for a " << width << "x" << height << " icon with parameter " << parameter << std::endl;
+	return false;
+}
+
+
+static bool checkKernels() {
+	const uint64_t outputBytes = (uint64_t)maxCheckedSize * maxCheckedSize * 8;
+	std::vector<uint8_t> image;
+	std::vector<uint8_t> kernelOutput(outputBytes);
+	std::vector<uint8_t> referenceOutput(outputBytes);
+	srand(1);
+	for(unsigned int check = 0; check < numChecks; check++) {
+		const uint32_t width = 1 + (rand() % maxCheckedSize);
+		const uint32_t height = 1 + (rand() % maxCheckedSize);
+		randomImage(width, height, image);
+		for(unsigned int quarterTurns = 0; quarterTurns < 4; quarterTurns++) {
+			kernelOutput.assign(outputBytes, filler);
+			referenceOutput.assign(outputBytes, filler);
+			BitKernels::rotate(image.data(), width, height, quarterTurns, kernelOutput.data());
+			referenceRotate(image.data(), width, height, quarterTurns, referenceOutput.data());
+			if(kernelOutput != referenceOutput) {
+				return reportMismatch("rotate", width, height, quarterTurns);
+			}
+		}
+		kernelOutput.assign(outputBytes, filler);
+		referenceOutput.assign(outputBytes, filler);
+		BitKernels::mirror(image.data(), width, height, kernelOutput.data());
+		referenceMirror(image.data(), width, height, referenceOutput.data());
+		if(kernelOutput != referenceOutput) {
+			return reportMismatch("mirror", width, height, 0);
+		}
+		for(unsigned int factor = 1; factor <= 8; factor++) {
+			kernelOutput.assign(outputBytes, filler);
+			referenceOutput.assign(outputBytes, filler);
+			BitKernels::scale(image.data(), width, height, factor, kernelOutput.data());
+			referenceScale(image.data(), width, height, factor, referenceOutput.data());
+			if(kernelOutput != referenceOutput) {
+				return reportMismatch("scale", width, height, factor);
+			}
+		}
+	}
+	std::cout << "Rotation, mirroring and scaling agree with the references for " << numChecks << " random icons up to "
+			<< maxCheckedSize << "x" << maxCheckedSize << std::endl;
+	return true;
+}
+
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+static void timeKernels() {
+	const uint64_t iconBytes = (uint64_t)((timedSize + 7) / 8) * timedSize;
+	std::vector<uint8_t> icons;
+	randomImage(timedSize, timedSize * numTimedIcons, icons);
+	std::vector<uint8_t> output(iconBytes * 9);
+	for(unsigned int quarterTurns = 1; quarterTurns < 4; quarterTurns++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(unsigned int icon = 0; icon < numTimedIcons; icon++) {
+			BitKernels::rotate(&icons[icon * iconBytes], timedSize, timedSize, quarterTurns, output.data());
+		}
+		const double kernelTime = millisecondsSince(start);
+		start = std::chrono::steady_clock::now();
+		for(unsigned int icon = 0; icon < numTimedIcons; icon++) {
+			referenceRotate(&icons[icon * iconBytes], timedSize, timedSize, quarterTurns, output.data());
+		}
+		std::cout << "Turning " << numTimedIcons << " " << timedSize << "x" << timedSize << " icons by " << (90 * quarterTurns) << " degrees took "
+				<< kernelTime << " ms, and " << millisecondsSince(start) << " ms pixel by pixel" << std::endl;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(unsigned int icon = 0; icon < numTimedIcons; icon++) {
+		BitKernels::mirror(&icons[icon * iconBytes], timedSize, timedSize, output.data());
+	}
+	const double mirrorTime = millisecondsSince(start);
+	start = std::chrono::steady_clock::now();
+	for(unsigned int icon = 0; icon < numTimedIcons; icon++) {
+		referenceMirror(&icons[icon * iconBytes], timedSize, timedSize, output.data());
+	}
+	std::cout << "Mirroring them took " << mirrorTime << " ms, and " << millisecondsSince(start) << " ms pixel by pixel" << std::endl;
+	for(unsigned int factor = 2; factor <= 3; factor++) {
+		start = std::chrono::steady_clock::now();
+		for(unsigned int icon = 0; icon < numTimedIcons; icon++) {
+			BitKernels::scale(&icons[icon * iconBytes], timedSize, timedSize, factor, output.data());
+		}
+		const double kernelTime = millisecondsSince(start);
+		start = std::chrono::steady_clock::now();
+		for(unsigned int icon = 0; icon < numTimedIcons; icon++) {
+			referenceScale(&icons[icon * iconBytes], timedSize, timedSize, factor, output.data());
+		}
+		std::cout << "Scaling them by " << factor << " took " << kernelTime << " ms, and " << millisecondsSince(start) << " ms pixel by pixel" << std::endl;
+	}
+}
+
+
+int main() {
+	if(!checkKernels()) {
+		return 1;
+	}
+	timeKernels();
+	return 0;
+}
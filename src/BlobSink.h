@@ -0,0 +1,171 @@
+//============================================================================
+// Name			: Blob Sink (BlobSink.h)
+// Description 	: Base for outputs that encode each icon into a block of bytes
+//				: and store all the blocks in one indexed file
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _BLOB_SINK_LIB_H
+#define _BLOB_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <stdint.h>
+
+#include "IconSink.h"
+
+// Base class for outputs whose icons are encoded into blocks of bytes of varying length. The blocks
+// are collected in memory and written out by finish() in the same layout as the atlas:
+//   Header, 16 bytes:        four character identifier, uint32 version, uint32 number of icons, uint32 reserved
+//   Index, 16 bytes per icon: uint64 offset of the icon's block from start of file, uint32 width, uint32 height
+//   Blocks:                  one after another in icon order. A block ends where the next one starts.
+// All values little endian.
+class BlobSink : public IconSink {
+
+private:
+	const std::string path;
+	const std::string identifier;
+	const uint32_t version;
+	std::vector<uint64_t> blockOffsets;
+	std::vector<uint32_t> widths;
+	std::vector<uint32_t> heights;
+
+	BlobSink(const BlobSink &);
+	BlobSink & operator=(const BlobSink &);
+
+protected:
+	std::vector<uint8_t> blocks;
+
+	// Appends the encoding of one icon to blocks
+	virtual bool encode(const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) = 0;
+
+
+	// Most bytes that encode() can append for an icon of the given dimensions
+	virtual uint64_t maxBlockBytes(uint32_t iconWidth, uint32_t iconHeight) const = 0;
+
+public:
+	static const uint32_t headerSize = 16;
+	static const uint32_t indexEntrySize = 16;
+
+	// Constructor. fileIdentifier is the four characters the file starts with
+	BlobSink(const std::string & blobPath, const std::string & fileIdentifier, uint32_t fileVersion) : path(blobPath),
+		identifier(fileIdentifier), version(fileVersion) {
+		//
+	}
+
+
+	bool begin(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) {
+		widths = iconWidths;
+		heights = iconHeights;
+		blockOffsets.assign(iconWidths.size() + 1, 0);
+		// Reserved so that growing the blocks never holds an old and a new copy of them at once
+		uint64_t totalBlockBytes = 0;
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			totalBlockBytes += maxBlockBytes(iconWidths[i], iconHeights[i]);
+		}
+		blocks.reserve(totalBlockBytes);
+		return true;
+	}
+
+
+	bool writeIcon(uint32_t icon, const std::string & /*name*/, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		blockOffsets[icon] = blocks.size();
+		if(!encode(iconData, iconWidth, iconHeight)) {
+			return false;
+		}
+		blockOffsets[icon + 1] = blocks.size();
+		return true;
+	}
+
+
+	// Start and length of an icon's block within blocks
+	const uint8_t * block(uint32_t icon) const {
+		return blocks.data() + blockOffsets[icon];
+	}
+
+
+	uint64_t blockLength(uint32_t icon) const {
+		return blockOffsets[icon + 1] - blockOffsets[icon];
+	}
+
+
+	uint32_t numIcons() const {
+		return widths.size();
+	}
+
+
+	uint32_t width(uint32_t icon) const {
+		return widths[icon];
+	}
+
+
+	uint32_t height(uint32_t icon) const {
+		return heights[icon];
+	}
+
+
+	bool finish() {
+		const uint32_t count = widths.size();
+		const uint64_t firstBlock = headerSize + ((uint64_t)count * indexEntrySize);
+		std::vector<char> index(firstBlock);
+		memcpy(&index[0], identifier.data(), 4);
+		memcpy(&index[4], &version, sizeof(uint32_t));
+		memcpy(&index[8], &count, sizeof(uint32_t));
+		memset(&index[12], 0, sizeof(uint32_t));
+		for(uint32_t i = 0; i < count; i++) {
+			const uint64_t offset = firstBlock + blockOffsets[i];
+			char * entry = &index[headerSize + ((uint64_t)i * indexEntrySize)];
+			memcpy(entry, &offset, sizeof(uint64_t));
+			memcpy(entry + 8, &widths[i], sizeof(uint32_t));
+			memcpy(entry + 12, &heights[i], sizeof(uint32_t));
+		}
+		std::ofstream blob(path.c_str(), (std::ofstream::out | std::ofstream::binary | std::ofstream::trunc));
+		blob.write(&index[0], index.size());
+		blob.write((const char *)blocks.data(), blocks.size());
+		blob.close();
+		return !blob.fail();
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return "icon " + name + " of " + path;
+	}
+
+
+	// The blocks, the index built by finish() and the dimensions and offsets of every icon
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		uint64_t numBytes = headerSize + ((uint64_t)iconWidths.size() * (indexEntrySize + (2 * sizeof(uint32_t)) + sizeof(uint64_t)));
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			numBytes += maxBlockBytes(iconWidths[i], iconHeights[i]);
+		}
+		return numBytes;
+	}
+
+
+	// Number of bytes of encoded icon data
+	uint64_t sizeOfBlocks() const {
+		return blocks.size();
+	}
+
+};
+#endif
@@ -0,0 +1,88 @@
+//============================================================================
+// Name			: BMP Header (BmpHeader.h)
+// Description 	: The smallest complete set of headers for a one-bit-per-pixel
+//				: Windows Bitmap file: a 14 byte file header, a 40 byte
+//				: BITMAPINFOHEADER and a two entry colour table
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _BMP_HEADER_LIB_H
+#define _BMP_HEADER_LIB_H
+
+#include <cstring>
+#include <stdint.h>
+
+namespace BmpHeader {
+
+	// Total length of the canonical headers, which is also the offset of the bit map data
+	constexpr unsigned int canonicalSize = 62;
+
+	// Longest headers a file can need: the file header, the largest DIB header (BITMAPV5HEADER, 124 bytes)
+	// and a full 256 entry colour table
+	constexpr unsigned int maxSize = 14 + 124 + (256 * 4);
+
+	// Field positions, the same in the canonical headers as in the larger DIB header variants
+	constexpr unsigned int fileSizeOffset = 2;
+	constexpr unsigned int widthOffset = 18;
+	constexpr unsigned int heightOffset = 22;
+	constexpr unsigned int dataLengthOffset = 34;
+	constexpr unsigned int colourTableOffset = 54;
+
+	// Little endian template. The file size, width, height, bit map data length and colours are filled in per icon.
+	constexpr uint8_t canonical[canonicalSize] = {
+		// Bitmap file header
+		'B', 'M',					// File identifier
+		0x00, 0x00, 0x00, 0x00,		// File size in bytes
+		0x00, 0x00, 0x00, 0x00,		// Reserved
+		0x3E, 0x00, 0x00, 0x00,		// Offset of the bit map data (62)
+		// BITMAPINFOHEADER
+		0x28, 0x00, 0x00, 0x00,		// DIB header length (40)
+		0x00, 0x00, 0x00, 0x00,		// Image width in pixels
+		0x00, 0x00, 0x00, 0x00,		// Image height in pixels
+		0x01, 0x00,					// Colour planes
+		0x01, 0x00,					// Bits per pixel
+		0x00, 0x00, 0x00, 0x00,		// Compression method (none)
+		0x00, 0x00, 0x00, 0x00,		// Length of bit map data
+		0x13, 0x0B, 0x00, 0x00,		// Horizontal resolution (2835 pixels per metre, 72 DPI)
+		0x13, 0x0B, 0x00, 0x00,		// Vertical resolution
+		0x02, 0x00, 0x00, 0x00,		// Colours in colour table
+		0x00, 0x00, 0x00, 0x00,		// Important colours (all)
+		// Colour table, BGRA
+		0x00, 0x00, 0x00, 0x00,		// Index 0
+		0xFF, 0xFF, 0xFF, 0x00		// Index 1
+	};
+
+
+	// Fills dest with the canonical headers for a one-bit-per-pixel image of the given dimensions.
+	// colour0 and colour1 are the colour table entries for pixel values 0 and 1.
+	inline void writeCanonical(char * dest, uint32_t width, uint32_t height, uint32_t dataLength, uint32_t colour0, uint32_t colour1) {
+		const uint32_t fileSize = canonicalSize + dataLength;
+		memcpy(dest, canonical, canonicalSize);
+		memcpy(dest + fileSizeOffset, &fileSize, sizeof(uint32_t));
+		memcpy(dest + widthOffset, &width, sizeof(uint32_t));
+		memcpy(dest + heightOffset, &height, sizeof(uint32_t));
+		memcpy(dest + dataLengthOffset, &dataLength, sizeof(uint32_t));
+		memcpy(dest + colourTableOffset, &colour0, sizeof(uint32_t));
+		memcpy(dest + colourTableOffset + sizeof(uint32_t), &colour1, sizeof(uint32_t));
+	}
+
+}
+#endif
@@ -0,0 +1,139 @@
+//============================================================================
+// Name			: BMP Sink (BmpSink.h)
+// Description 	: Turns each extracted icon into a one-bit-per-pixel Windows
+//				: Bitmap file and writes it to a directory or an archive
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _BMP_SINK_LIB_H
+#define _BMP_SINK_LIB_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+
+#include "IconSink.h"
+#include "FileSink.h"
+#include "BmpHeader.h"
+
+// Class for writing each icon as its own bitmap file
+class BmpSink : public IconSink {
+
+private:
+	FileSink * files;
+	const std::vector<char> sourceHeaders;	// input file up to the start of its bit map data
+	const uint32_t colourTableOffset;
+	const uint32_t darkColour;
+	const uint32_t lightColour;
+	const bool minimalHeaders;
+	const unsigned int numShards;
+	std::vector<char> iconFile;
+
+	BmpSink(const BmpSink &);
+	BmpSink & operator=(const BmpSink &);
+
+public:
+	// Constructor. Takes ownership of files. The icon files either copy the input file's headers,
+	// patched for each icon, or carry the canonical minimal headers
+	BmpSink(FileSink * fileSink, const std::vector<char> & headers, uint32_t colourTableStart, uint32_t dark, uint32_t light,
+			bool minimal, unsigned int shards) : files(fileSink), sourceHeaders(headers), colourTableOffset(colourTableStart),
+			darkColour(dark), lightColour(light), minimalHeaders(minimal), numShards(shards) {
+		//
+	}
+
+
+	~BmpSink() {
+		delete files;
+	}
+
+
+	// Size of the headers at the start of each icon file
+	uint32_t headersSize() const {
+		return minimalHeaders ? BmpHeader::canonicalSize : sourceHeaders.size();
+	}
+
+
+	bool writeIcon(uint32_t /*icon*/, const std::string & name, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		// Bitmap files pad each row to a multiple of 4 bytes and store the rows from bottom to top
+		const uint32_t bytesInIconRow = (iconWidth + 7) / 8;
+		const uint32_t bytesInFileRow = ((bytesInIconRow + 3) / 4) * 4;
+		const uint32_t iconFileDataSize = bytesInFileRow * iconHeight;
+		const uint32_t iconFileSize = headersSize() + iconFileDataSize;
+
+		// The icon file is assembled in memory and then handed to the output in one piece
+		iconFile.resize(iconFileSize);
+		if(minimalHeaders) {
+			// Build the headers from the canonical template. The icon data is normalised so that
+			// 0 is the darker colour of the input file and 1 the lighter one
+			BmpHeader::writeCanonical(&iconFile[0], iconWidth, iconHeight, iconFileDataSize, darkColour, lightColour);
+		}
+		else {
+			// Use the headers from the original bitmap file to form the foundation of the headers for the individual icons' bitmap files
+			// The original header must now be modified for:
+			// 		- the new icon bitmap file size (bmp header)
+			//		- the new icon bitmap width (dib header)
+			//		- the new icon bitmap height (dib header)
+			//		- length of bit map data (dib header)
+			// 		- colours in colour table may need to be swapped around
+			memcpy(&iconFile[0], &sourceHeaders[0], sourceHeaders.size());
+			memcpy(&iconFile[BmpHeader::fileSizeOffset], &iconFileSize, sizeof(uint32_t));
+			memcpy(&iconFile[BmpHeader::widthOffset], &iconWidth, sizeof(uint32_t));
+			memcpy(&iconFile[BmpHeader::heightOffset], &iconHeight, sizeof(uint32_t));
+			memcpy(&iconFile[BmpHeader::dataLengthOffset], &iconFileDataSize, sizeof(uint32_t));
+			memcpy(&iconFile[colourTableOffset], &darkColour, sizeof(uint32_t));
+			memcpy(&iconFile[colourTableOffset + sizeof(uint32_t)], &lightColour, sizeof(uint32_t));
+		}
+
+		// Write iconData to iconFile
+		// extra padding bytes must be written to the end of each line
+		char * fileRow = &iconFile[headersSize()];
+		for(uint32_t row = 0; row < iconHeight; row++, fileRow += bytesInFileRow) {
+			memcpy(fileRow, iconData + ((uint64_t)(iconHeight - 1 - row) * bytesInIconRow), bytesInIconRow);
+			memset(fileRow + bytesInIconRow, 0xFF, bytesInFileRow - bytesInIconRow);
+		}
+
+		return files->writeFile(FileSink::shardedName(name + ".bmp", numShards), &iconFile[0], iconFile.size());
+	}
+
+
+	bool finish() {
+		return files->finish();
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return files->describe(FileSink::shardedName(name + ".bmp", numShards));
+	}
+
+
+	// The largest icon file, which is assembled in memory, and the buffers of the files output
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		uint64_t largestFileBytes = 0;
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			largestFileBytes = std::max(largestFileBytes, headersSize() + ((uint64_t)((((iconWidths[i] + 7) / 8) + 3) / 4) * 4 * iconHeights[i]));
+		}
+		return largestFileBytes + files->bufferBytes();
+	}
+
+};
+#endif
@@ -0,0 +1,142 @@
+//============================================================================
+// Name			: C Header Sink (CHeaderSink.h)
+// Description 	: Writes every icon into a C header file as a constant byte
+//				: array, with a table of the icons' dimensions
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _C_HEADER_SINK_LIB_H
+#define _C_HEADER_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <cctype>
+#include <stdint.h>
+
+#include "IconSink.h"
+
+// Class for writing every icon into a C header as a constant array of its rows, packed to whole
+// bytes, followed by a table of every icon's dimensions and data.
+// Identifiers are prefixed with the name of the header file, e.g. icons.h declares icons_000,
+// icons_table and ICONS_COUNT.
+class CHeaderSink : public IconSink {
+
+private:
+	const std::string path;
+	const bool lsbFirst;
+	std::string prefix;
+	std::string guard;
+	std::ofstream header;
+	std::string text;
+	std::string table;
+
+	CHeaderSink(const CHeaderSink &);
+	CHeaderSink & operator=(const CHeaderSink &);
+
+public:
+	// Constructor. The icon data handed to it is least significant bit first if leastSignificantBitFirst is true
+	CHeaderSink(const std::string & headerPath, bool leastSignificantBitFirst) : path(headerPath), lsbFirst(leastSignificantBitFirst) {
+		const std::string::size_type slash = path.rfind('/');
+		const std::string fileName = (slash == std::string::npos) ? path : path.substr(slash + 1);
+		for(std::string::size_type i = 0; i < fileName.size() && fileName[i] != '.'; i++) {
+			prefix += isalnum((unsigned char)fileName[i]) ? fileName[i] : '_';
+		}
+		if(prefix.empty() || isdigit((unsigned char)prefix[0])) {
+			prefix = "icons_" + prefix;
+		}
+		for(std::string::size_type i = 0; i < prefix.size(); i++) {
+			guard += toupper((unsigned char)prefix[i]);
+		}
+	}
+
+
+	// Starts the header. The icon arrays are then written out as the icons arrive.
+	bool begin(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & /*iconHeights*/) {
+		header.open(path.c_str(), (std::ofstream::out | std::ofstream::trunc));
+		header << "// Icons as rows of bytes, " << (lsbFirst ? "least" : "most") << " significant bit first, 0 for black and 1 for white\n";
+		header << "#ifndef " << guard << "_H\n#define " << guard << "_H\n\n#include <stdint.h>\n\n";
+		header << "#define " << guard << "_COUNT " << iconWidths.size() << "\n\n";
+		return !header.fail();
+	}
+
+
+	bool writeIcon(uint32_t /*icon*/, const std::string & name, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		const uint32_t bytesInIconRow = (iconWidth + 7) / 8;
+		char number[16];
+		text.clear();
+		snprintf(number, sizeof(number), "%u", iconWidth);
+		text += "// " + name + ": " + number;
+		snprintf(number, sizeof(number), "%u", iconHeight);
+		text += " x " + std::string(number) + " pixels\n";
+		// Names such as 0001@2x become identifiers such as icons_0001_2x
+		std::string identifier = prefix + "_" + name;
+		for(std::string::size_type i = prefix.size(); i < identifier.size(); i++) {
+			identifier[i] = isalnum((unsigned char)identifier[i]) ? identifier[i] : '_';
+		}
+		text += "static const uint8_t " + identifier + "[] = {\n";
+		for(uint32_t row = 0; row < iconHeight; row++) {
+			text += "\t";
+			for(uint32_t byte = 0; byte < bytesInIconRow; byte++) {
+				snprintf(number, sizeof(number), "0x%02X,", iconData[((uint64_t)row * bytesInIconRow) + byte]);
+				text += number;
+			}
+			text += "\n";
+		}
+		text += "};\n\n";
+		header << text;
+		snprintf(number, sizeof(number), "%u, %u, ", iconWidth, iconHeight);
+		table += "\t{" + std::string(number) + identifier + "},\n";
+		return !header.fail();
+	}
+
+
+	bool finish() {
+		if(!table.empty()) {
+			header << "static const struct {\n\tuint16_t width;\n\tuint16_t height;\n\tconst uint8_t * data;\n} " << prefix << "_table[] = {\n";
+			header << table << "};\n\n";
+		}
+		header << "#endif\n";
+		header.close();
+		return !header.fail();
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return prefix + "_" + name + " in " + path;
+	}
+
+
+	// The text of the largest icon and the table of every icon, which strings may hold twice over as they grow
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		const uint64_t identifierBytes = prefix.size() + 1 + nameAllowance;
+		uint64_t largestTextBytes = 0;
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			// Each byte is written as 0xFF, and each row as a tab, the bytes and a newline
+			largestTextBytes = std::max(largestTextBytes, ((uint64_t)iconHeights[i] * ((5 * ((iconWidths[i] + 7) / 8)) + 2)) + (2 * identifierBytes) + 64);
+		}
+		return 2 * (largestTextBytes + ((uint64_t)iconWidths.size() * (identifierBytes + 32)));
+	}
+
+};
+#endif
@@ -0,0 +1,94 @@
+//============================================================================
+// Name			: CRC-32C (Crc32c.h)
+// Description 	: CRC-32C (Castagnoli) checksums, using the SSE4.2 crc32
+//				: instruction where the processor has it
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _CRC32C_LIB_H
+#define _CRC32C_LIB_H
+
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#endif
+
+// CRC-32C as used by iSCSI, ext4 and SSE4.2: reflected polynomial 0x82F63B78, initial value and
+// final XOR of 0xFFFFFFFF. The checksum of the ASCII string "123456789" is 0xE3069283.
+namespace Crc32c {
+
+	// Byte at a time with a lookup table, for processors without the crc32 instruction
+	inline uint32_t computeWithTable(const uint8_t * data, size_t numBytes) {
+		static const struct lookupTable {
+			uint32_t entries[256];
+			lookupTable() {
+				for(uint32_t byte = 0; byte < 256; byte++) {
+					uint32_t crc = byte;
+					for(int bit = 0; bit < 8; bit++) {
+						crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78u : 0);
+					}
+					entries[byte] = crc;
+				}
+			}
+		} table;
+		uint32_t crc = 0xFFFFFFFFu;
+		for(size_t i = 0; i < numBytes; i++) {
+			crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+#if defined(__x86_64__)
+	// Eight bytes at a time with the SSE4.2 crc32 instruction. Compiled for SSE4.2 whatever the
+	// target of the rest of the program, so must only be called once the processor is known to have it.
+	__attribute__((target("sse4.2")))
+	inline uint32_t computeWithInstruction(const uint8_t * data, size_t numBytes) {
+		uint64_t crc = 0xFFFFFFFFu;
+		size_t i = 0;
+		for(; i + sizeof(uint64_t) <= numBytes; i += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, data + i, sizeof(uint64_t));
+			crc = _mm_crc32_u64(crc, word);
+		}
+		uint32_t crc32 = (uint32_t)crc;
+		for(; i < numBytes; i++) {
+			crc32 = _mm_crc32_u8(crc32, data[i]);
+		}
+		return crc32 ^ 0xFFFFFFFFu;
+	}
+#endif
+
+	// Checksum of a block of data, using the fastest method the processor supports
+	inline uint32_t compute(const uint8_t * data, size_t numBytes) {
+#if defined(__x86_64__)
+		static const bool hasInstruction = __builtin_cpu_supports("sse4.2");
+		if(hasInstruction) {
+			return computeWithInstruction(data, numBytes);
+		}
+#endif
+		return computeWithTable(data, numBytes);
+	}
+
+}
+#endif
@@ -0,0 +1,325 @@
+//============================================================================
+// Name			: Distance Field Sink (DistanceFieldSink.h)
+// Description 	: Writes a signed distance field of every icon into one 8 bit
+//				: greyscale atlas, with a table of where each icon's field is
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _DISTANCE_FIELD_SINK_LIB_H
+#define _DISTANCE_FIELD_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+#include "IconSink.h"
+#include "SkylinePacker.h"
+
+// Class for writing signed distance fields of the icons, for drawing them smoothly at any size. The
+// field of each icon extends spread pixels beyond every edge of the icon and is reduced by a whole
+// number factor, so a field of a quarter of the size is written with a downscale of 4. Each output
+// pixel is the mean distance over the source pixels it covers, mapped to
+//   128 - (127 * distance / spread), clamped to 0..255
+// where distance is negative inside the ink, so ink is above 128, background below and the outline at 128.
+//
+// The fields are packed into one binary PGM (P5) image at the given path, with unused parts 0, and
+// <path>.csv gives for each icon: name,x,y,width,height,icon_width,icon_height where x,y,width,height
+// locate its field in the image and the icon itself starts spread source pixels into the field.
+//
+// Distances are exact Euclidean distances, from the separable transform of Felzenszwalb and Huttenlocher:
+// the squared distance along each column, then along each row, each the lower envelope of parabolas in
+// time linear in the length of the line. The icons are kept until finish(), which shares them out
+// between worker threads.
+class DistanceFieldSink : public IconSink {
+
+private:
+	const std::string path;
+	const uint32_t spread;
+	const uint32_t downscale;
+	std::vector<uint32_t> widths;
+	std::vector<uint32_t> heights;
+	std::vector<uint32_t> fieldWidths;
+	std::vector<uint32_t> fieldHeights;
+	std::vector<std::string> names;
+	std::vector<uint64_t> iconOffsets;
+	std::vector<uint8_t> icons;				// every icon's data, in icon order
+	SkylinePacker packer;
+	std::vector<uint8_t> atlas;
+	uint32_t atlasWidth;
+	std::chrono::steady_clock::duration timeTransforming;
+	unsigned int numWorkers;
+	unsigned int workerLimit;				// 0 for one worker per hardware thread
+
+	DistanceFieldSink(const DistanceFieldSink &);
+	DistanceFieldSink & operator=(const DistanceFieldSink &);
+
+	// Squared distances along a line of n values, f being 0 at the features and far away elsewhere.
+	// Scratch space: v for n parabola positions, z for n+1 boundaries between them.
+	static void transformLine(const double * f, uint32_t n, double * d, uint32_t * v, double * z) {
+		uint32_t k = 0;
+		v[0] = 0;
+		z[0] = -HUGE_VAL;
+		z[1] = HUGE_VAL;
+		for(uint32_t q = 1; q < n; q++) {
+			double s = ((f[q] + ((double)q * q)) - (f[v[k]] + ((double)v[k] * v[k]))) / (2.0 * q - 2.0 * v[k]);
+			while(s <= z[k]) {
+				k--;
+				s = ((f[q] + ((double)q * q)) - (f[v[k]] + ((double)v[k] * v[k]))) / (2.0 * q - 2.0 * v[k]);
+			}
+			k++;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = HUGE_VAL;
+		}
+		k = 0;
+		for(uint32_t q = 0; q < n; q++) {
+			while(z[k + 1] < q) {
+				k++;
+			}
+			d[q] = (((double)q - v[k]) * ((double)q - v[k])) + f[v[k]];
+		}
+	}
+
+
+	// Squared distance from every pixel of a grid to the nearest feature, in place
+	static void transformGrid(std::vector<double> & grid, uint32_t width, uint32_t height) {
+		const uint32_t longest = std::max(width, height);
+		std::vector<double> f(longest);
+		std::vector<double> d(longest);
+		std::vector<uint32_t> v(longest);
+		std::vector<double> z(longest + 1);
+		for(uint32_t x = 0; x < width; x++) {
+			for(uint32_t y = 0; y < height; y++) {
+				f[y] = grid[((uint64_t)y * width) + x];
+			}
+			transformLine(f.data(), height, d.data(), v.data(), z.data());
+			for(uint32_t y = 0; y < height; y++) {
+				grid[((uint64_t)y * width) + x] = d[y];
+			}
+		}
+		for(uint32_t y = 0; y < height; y++) {
+			double * row = &grid[(uint64_t)y * width];
+			std::copy(row, row + width, f.begin());
+			transformLine(f.data(), width, row, v.data(), z.data());
+		}
+	}
+
+
+	// Computes the field of one icon into its place in the atlas
+	void transformIcon(uint32_t icon) {
+		// far stands in for infinity. It is finite so that the parabolas of far pixels still have boundaries
+		const double far = 1e20;
+		const uint32_t width = widths[icon];
+		const uint32_t height = heights[icon];
+		const uint32_t gridWidth = width + (2 * spread);
+		const uint32_t gridHeight = height + (2 * spread);
+		const uint32_t bytesPerRow = (width + 7) / 8;
+		const uint8_t * iconData = &icons[iconOffsets[icon]];
+		// Distances to the nearest ink, and inside the ink to the nearest background
+		std::vector<double> toInk((uint64_t)gridWidth * gridHeight, far);
+		std::vector<double> toBackground((uint64_t)gridWidth * gridHeight, 0.0);
+		for(uint32_t row = 0; row < height; row++) {
+			for(uint32_t col = 0; col < width; col++) {
+				if(((iconData[((uint64_t)row * bytesPerRow) + (col / 8)] >> (7 - (col % 8))) & 1) == 0) {
+					const uint64_t pixel = ((uint64_t)(row + spread) * gridWidth) + col + spread;
+					toInk[pixel] = 0.0;
+					toBackground[pixel] = far;
+				}
+			}
+		}
+		transformGrid(toInk, gridWidth, gridHeight);
+		transformGrid(toBackground, gridWidth, gridHeight);
+
+		for(uint32_t fieldRow = 0; fieldRow < fieldHeights[icon]; fieldRow++) {
+			uint8_t * atlasRow = &atlas[((uint64_t)(packer.y(icon) + fieldRow) * atlasWidth) + packer.x(icon)];
+			for(uint32_t fieldCol = 0; fieldCol < fieldWidths[icon]; fieldCol++) {
+				double totalDistance = 0.0;
+				uint32_t numPixels = 0;
+				for(uint32_t y = fieldRow * downscale; y < std::min((fieldRow + 1) * downscale, gridHeight); y++) {
+					for(uint32_t x = fieldCol * downscale; x < std::min((fieldCol + 1) * downscale, gridWidth); x++) {
+						const uint64_t pixel = ((uint64_t)y * gridWidth) + x;
+						totalDistance += std::sqrt(toInk[pixel]) - std::sqrt(toBackground[pixel]);
+						numPixels++;
+					}
+				}
+				const double value = 128.0 - ((127.0 * (totalDistance / numPixels)) / spread);
+				atlasRow[fieldCol] = (uint8_t)std::min(255.0, std::max(0.0, std::floor(value + 0.5)));
+			}
+		}
+	}
+
+
+	// Dimensions of the field of every icon, which reaches spread pixels beyond the icon and is downscaled
+	void fieldDimensions(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights, std::vector<uint32_t> & widthsOfFields,
+			std::vector<uint32_t> & heightsOfFields) const {
+		widthsOfFields.resize(iconWidths.size());
+		heightsOfFields.resize(iconHeights.size());
+		for(uint32_t icon = 0; icon < iconWidths.size(); icon++) {
+			widthsOfFields[icon] = (iconWidths[icon] + (2 * spread) + downscale - 1) / downscale;
+			heightsOfFields[icon] = (iconHeights[icon] + (2 * spread) + downscale - 1) / downscale;
+		}
+	}
+
+
+	// Computes the fields of icons first to last-1. Run on several threads at once, each with its own range of icons
+	void transformIcons(uint32_t first, uint32_t last) {
+		for(uint32_t icon = first; icon < last; icon++) {
+			transformIcon(icon);
+		}
+	}
+
+public:
+	// Constructor. spread and downscale are at least 1
+	DistanceFieldSink(const std::string & fieldPath, uint32_t spreadPixels, uint32_t downscaleFactor) : path(fieldPath),
+		spread(spreadPixels), downscale(downscaleFactor), packer(1), atlasWidth(0), timeTransforming(0), numWorkers(0),
+		workerLimit(0) {
+		//
+	}
+
+
+	// Packs the fields, whose sizes follow from the icons' sizes
+	bool begin(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) {
+		widths = iconWidths;
+		heights = iconHeights;
+		fieldDimensions(widths, heights, fieldWidths, fieldHeights);
+		packer.pack(fieldWidths, fieldHeights);
+		names.resize(widths.size());
+		iconOffsets.assign(widths.size(), 0);
+		// Reserved so that the icons are never copied as they arrive
+		uint64_t iconBytes = 0;
+		for(uint32_t icon = 0; icon < widths.size(); icon++) {
+			iconBytes += (uint64_t)((widths[icon] + 7) / 8) * heights[icon];
+		}
+		icons.reserve(iconBytes);
+		return true;
+	}
+
+
+	bool writeIcon(uint32_t icon, const std::string & name, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		iconOffsets[icon] = icons.size();
+		icons.insert(icons.end(), iconData, iconData + ((uint64_t)((iconWidth + 7) / 8) * iconHeight));
+		names[icon] = name;
+		return true;
+	}
+
+
+	bool finish() {
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		atlasWidth = std::max(packer.width(), 1u);
+		const uint32_t atlasHeight = std::max(packer.height(), 1u);
+		atlas.assign((uint64_t)atlasWidth * atlasHeight, 0);
+		const uint32_t numIcons = widths.size();
+		numWorkers = std::min<unsigned int>(std::max(1u, std::thread::hardware_concurrency()), std::max(numIcons, 1u));
+		numWorkers = (workerLimit != 0) ? std::min(numWorkers, workerLimit) : numWorkers;
+		std::vector<std::future<void>> workers;
+		for(unsigned int worker = 0; worker < numWorkers; worker++) {
+			workers.push_back(std::async(std::launch::async, &DistanceFieldSink::transformIcons, this,
+					((uint64_t)numIcons * worker) / numWorkers, ((uint64_t)numIcons * (worker + 1)) / numWorkers));
+		}
+		for(unsigned int worker = 0; worker < numWorkers; worker++) {
+			workers[worker].get();
+		}
+		timeTransforming = std::chrono::steady_clock::now() - start;
+
+		std::ofstream image(path.c_str(), (std::ofstream::out | std::ofstream::binary | std::ofstream::trunc));
+		image << "P5\n" << atlasWidth << ' ' << atlasHeight << "\n255\n";
+		image.write((const char *)atlas.data(), atlas.size());
+		image.close();
+		std::ofstream metrics((path + ".csv").c_str(), (std::ofstream::out | std::ofstream::trunc));
+		metrics << "# spread " << spread << " downscale " << downscale << "\n";
+		metrics << "name,x,y,width,height,icon_width,icon_height\n";
+		for(uint32_t icon = 0; icon < numIcons; icon++) {
+			metrics << names[icon] << ',' << packer.x(icon) << ',' << packer.y(icon) << ',' << fieldWidths[icon] << ','
+					<< fieldHeights[icon] << ',' << widths[icon] << ',' << heights[icon] << '\n';
+		}
+		metrics.close();
+		return !image.fail() && !metrics.fail();
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return "distance field of icon " + name + " for " + path;
+	}
+
+
+	// Every icon, the atlas of fields and the bookkeeping for each icon, along with one worker. The fields
+	// are packed here as they will be in begin(), to find the size of the atlas
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		std::vector<uint32_t> widthsOfFields;
+		std::vector<uint32_t> heightsOfFields;
+		fieldDimensions(iconWidths, iconHeights, widthsOfFields, heightsOfFields);
+		SkylinePacker trialPacker(packer);
+		trialPacker.pack(widthsOfFields, heightsOfFields);
+		uint64_t numBytes = (uint64_t)std::max(trialPacker.width(), 1u) * std::max(trialPacker.height(), 1u);
+		for(uint32_t icon = 0; icon < iconWidths.size(); icon++) {
+			numBytes += ((uint64_t)((iconWidths[icon] + 7) / 8) * iconHeights[icon]) + (6 * sizeof(uint32_t)) + sizeof(uint64_t) + sizeof(std::string);
+		}
+		return numBytes + bytesForWorker(iconWidths, iconHeights);
+	}
+
+
+	// Bytes of memory each worker uses for the grids of the largest icon and its scratch lines
+	uint64_t bytesForWorker(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		uint64_t numBytes = 0;
+		for(uint32_t icon = 0; icon < iconWidths.size(); icon++) {
+			const uint64_t gridWidth = iconWidths[icon] + (2 * spread);
+			const uint64_t gridHeight = iconHeights[icon] + (2 * spread);
+			const uint64_t longest = std::max(gridWidth, gridHeight);
+			numBytes = std::max(numBytes, (2 * gridWidth * gridHeight * sizeof(double)) + (longest * ((3 * sizeof(double)) + sizeof(uint32_t))) + sizeof(double));
+		}
+		return numBytes;
+	}
+
+
+	// Limits how many workers compute the fields at once. 0 allows one per hardware thread
+	void limitWorkers(unsigned int maxWorkers) {
+		workerLimit = maxWorkers;
+	}
+
+
+	uint32_t width() const {
+		return packer.width();
+	}
+
+
+	uint32_t height() const {
+		return packer.height();
+	}
+
+
+	// Time taken to compute every field, in milliseconds
+	uint64_t millisecondsTransforming() const {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(timeTransforming).count();
+	}
+
+
+	unsigned int workersTransforming() const {
+		return numWorkers;
+	}
+
+};
+#endif
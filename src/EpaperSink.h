@@ -0,0 +1,115 @@
+//============================================================================
+// Name			: E-Paper Sink (EpaperSink.h)
+// Description 	: Writes every icon with two bits per pixel for e-paper panels,
+//				: either packed or as two separate bit planes
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _EPAPER_SINK_LIB_H
+#define _EPAPER_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "BlobSink.h"
+#include "BitKernels.h"
+
+// Class for writing icons for two bit per pixel e-paper controllers. Ink and background are each given a
+// two bit code, e.g. 0 for black and 3 for white on a four level grey panel, or a code whose upper bit
+// selects red on a black, white and red panel. The layouts are:
+//   PACKED  "IEP2"  ceil(width/4) bytes per row, rows from top to bottom, four pixels to a byte with the
+//                   first pixel in the top two bits
+//   PLANES  "IEPP"  the upper bits of every pixel's code as a plane of ceil(width/8) bytes per row, most
+//                   significant bit first, then the lower bits as a second plane of the same layout
+// Padding pixels at the end of each row take the background code.
+class EpaperSink : public BlobSink {
+
+public:
+	// Enumerator for the layouts
+	enum layout_t {PACKED, PLANES};
+
+private:
+	const layout_t layout;
+	const uint8_t inkCode;
+	const uint8_t backgroundCode;
+
+	// Bit plane byte for eight pixels of icon data, which has 1 for background and 0 for ink
+	static uint8_t planeByte(uint8_t iconByte, bool inkBit, bool backgroundBit) {
+		return (uint8_t)((inkBit ? ~iconByte : 0) | (backgroundBit ? iconByte : 0));
+	}
+
+protected:
+	bool encode(const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		const uint32_t bytesPerRow = (iconWidth + 7) / 8;
+		const bool inkHigh = (inkCode & 2) != 0;
+		const bool inkLow = (inkCode & 1) != 0;
+		const bool backgroundHigh = (backgroundCode & 2) != 0;
+		const bool backgroundLow = (backgroundCode & 1) != 0;
+		const uint64_t iconArraySize = (uint64_t)bytesPerRow * iconHeight;
+		if(layout == PLANES) {
+			const uint64_t blockStart = blocks.size();
+			blocks.resize(blockStart + (2 * iconArraySize));
+			for(uint64_t byte = 0; byte < iconArraySize; byte++) {
+				blocks[blockStart + byte] = planeByte(iconData[byte], inkHigh, backgroundHigh);
+				blocks[blockStart + iconArraySize + byte] = planeByte(iconData[byte], inkLow, backgroundLow);
+			}
+			return true;
+		}
+		// Each byte of icon data becomes two bytes of packed pixels, interleaving its two planes.
+		// The last byte of a row only supplies as many as the row needs
+		const uint32_t packedBytesPerRow = (iconWidth + 3) / 4;
+		const uint64_t blockStart = blocks.size();
+		blocks.resize(blockStart + ((uint64_t)packedBytesPerRow * iconHeight));
+		uint8_t * packed = &blocks[blockStart];
+		for(uint32_t row = 0; row < iconHeight; row++) {
+			const uint8_t * source = iconData + ((uint64_t)row * bytesPerRow);
+			uint32_t packedByte = 0;
+			for(uint32_t byte = 0; byte < bytesPerRow; byte++) {
+				const uint16_t pixels = BitKernels::interleaveBits(planeByte(source[byte], inkHigh, backgroundHigh), planeByte(source[byte], inkLow, backgroundLow));
+				packed[packedByte++] = (uint8_t)(pixels >> 8);
+				if(packedByte < packedBytesPerRow) {
+					packed[packedByte++] = (uint8_t)pixels;
+				}
+			}
+			packed += packedBytesPerRow;
+		}
+		return true;
+	}
+
+
+	uint64_t maxBlockBytes(uint32_t iconWidth, uint32_t iconHeight) const {
+		if(layout == PLANES) {
+			return 2 * (uint64_t)((iconWidth + 7) / 8) * iconHeight;
+		}
+		return (uint64_t)((iconWidth + 3) / 4) * iconHeight;
+	}
+
+public:
+	// Constructor. The codes are from 0 to 3
+	EpaperSink(const std::string & blobPath, layout_t pixelLayout, uint8_t inkPixelCode, uint8_t backgroundPixelCode) :
+		BlobSink(blobPath, ((pixelLayout == PACKED) ? "IEP2" : "IEPP"), 1), layout(pixelLayout), inkCode(inkPixelCode),
+		backgroundCode(backgroundPixelCode) {
+		//
+	}
+
+};
+#endif
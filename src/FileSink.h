@@ -0,0 +1,362 @@
+//============================================================================
+// Name			: File Sink (FileSink.h)
+// Description 	: Destinations for the files created by the program. Files are
+//				: either written individually into a directory or gathered
+//				: together into a single archive.
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _FILE_SINK_LIB_H
+#define _FILE_SINK_LIB_H
+
+#include <string>
+#include <map>
+#include <cstdio>
+#include <errno.h>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Base class for anything that output files can be written to
+class FileSink {
+
+public:
+	virtual ~FileSink() {
+		//
+	}
+
+
+	// Writes a complete file with the given name. The name may include subdirectories, separated by '/'.
+	virtual bool writeFile(const std::string & name, const char * data, uint64_t numBytes) = 0;
+
+
+	// Completes the output once every file has been written
+	virtual bool finish() = 0;
+
+
+	// Full path, or archive member name, that a file of the given name ends up at. For messages.
+	virtual std::string describe(const std::string & name) const = 0;
+
+
+	// Bytes of memory held in buffers until the output is finished
+	virtual uint64_t bufferBytes() const {
+		return 0;
+	}
+
+
+	// Spreads files across numShards subdirectories, named in hexadecimal, by a hash of the file name
+	// so that no one directory grows too large. Returns the name unchanged if numShards is 0 or 1.
+	static std::string shardedName(const std::string & name, unsigned int numShards) {
+		if(numShards < 2) {
+			return name;
+		}
+		// 32 bit FNV-1a
+		uint32_t hash = 2166136261u;
+		for(std::string::size_type i = 0; i < name.size(); i++) {
+			hash ^= (unsigned char)name[i];
+			hash *= 16777619u;
+		}
+		unsigned int numDigits = 1;
+		for(unsigned int largest = numShards - 1; largest > 0xF; largest >>= 4) {
+			numDigits++;
+		}
+		char shard[16];
+		snprintf(shard, sizeof(shard), "%0*x/", numDigits, hash % numShards);
+		return shard + name;
+	}
+
+};
+
+
+// Class for writing each file individually into a directory. Files are created relative to a descriptor
+// held open on the directory, so the kernel does not resolve the full path for every file.
+// With atomic publication the files are written into a staging directory alongside the output directory,
+// synced to disk, and swapped into place by finish(). Readers then see either the previous set of files or
+// the new one, never a mixture or a half-written set. The previous set is deleted, so an output directory
+// is only replaced if it is empty or was itself published by this class, which leaves a marker file in it.
+// The published directory keeps the permissions of the one it replaces.
+class DirectorySink : public FileSink {
+
+private:
+	const std::string outputDir;
+	const bool atomic;
+	std::string parentDir;				// directory containing outputDir, for atomic publication
+	std::string outputName;				// last component of outputDir
+	std::string stagingName;			// name of the staging directory within parentDir
+	mode_t outputMode;					// permissions given to the published directory
+	int parentFd;
+	int dirFd;							// directory the files are written into
+	std::map<std::string, int> subdirFds;
+	bool failed;
+	bool foreign;						// output directory holds files this class did not publish
+
+	DirectorySink(const DirectorySink &);
+	DirectorySink & operator=(const DirectorySink &);
+
+	// Descriptor of a subdirectory of the output, which is created if it does not yet exist
+	int subdirectory(const std::string & subdir) {
+		std::map<std::string, int>::iterator it = subdirFds.find(subdir);
+		if(it != subdirFds.end()) {
+			return it->second;
+		}
+		if(mkdirat(dirFd, subdir.c_str(), 0755) != 0 && errno != EEXIST) {
+			return -1;
+		}
+		const int fd = openat(dirFd, subdir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if(fd >= 0) {
+			subdirFds[subdir] = fd;
+		}
+		return fd;
+	}
+
+
+	// Closes the subdirectories, first syncing their entries to disk if asked. Returns false if a sync failed
+	bool closeSubdirectories(bool syncing) {
+		bool synced = true;
+		for(std::map<std::string, int>::iterator it = subdirFds.begin(); it != subdirFds.end(); it++) {
+			synced = (!syncing || fsync(it->second) == 0) && synced;
+			close(it->second);
+		}
+		subdirFds.clear();
+		return synced;
+	}
+
+
+	// Can a directory be replaced by a published one? Only if it is empty or holds the marker
+	static bool replaceable(int parentFd, const std::string & name) {
+		const int fd = openat(parentFd, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if(fd < 0) {
+			return false;
+		}
+		DIR * dir = fdopendir(fd);
+		if(dir == NULL) {
+			close(fd);
+			return false;
+		}
+		bool empty = true;
+		bool marked = false;
+		struct dirent * entry;
+		while((entry = readdir(dir)) != NULL) {
+			const std::string entryName = entry->d_name;
+			if(entryName != "." && entryName != "..") {
+				empty = false;
+				marked = marked || (entryName == markerName);
+			}
+		}
+		closedir(dir);
+		return empty || marked;
+	}
+
+
+	// Deletes a directory and everything in it
+	static bool removeTree(int parentFd, const std::string & name) {
+		const int fd = openat(parentFd, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if(fd < 0) {
+			return false;
+		}
+		DIR * dir = fdopendir(fd);
+		if(dir == NULL) {
+			close(fd);
+			return false;
+		}
+		bool success = true;
+		struct dirent * entry;
+		while((entry = readdir(dir)) != NULL) {
+			const std::string entryName = entry->d_name;
+			if(entryName == "." || entryName == "..") {
+				continue;
+			}
+			if(unlinkat(fd, entryName.c_str(), 0) != 0) {
+				success = removeTree(fd, entryName) && success;
+			}
+		}
+		closedir(dir);
+		return (unlinkat(parentFd, name.c_str(), AT_REMOVEDIR) == 0) && success;
+	}
+
+public:
+	// Name of the empty file marking a directory published atomically
+	static constexpr const char * markerName = ".iconextractor-output";
+
+	// Constructor. An empty directory is the current directory.
+	DirectorySink(const std::string & directory, bool atomicPublication) : outputDir(directory), atomic(atomicPublication),
+		outputMode(0755), parentFd(-1), dirFd(-1), failed(false), foreign(false) {
+		std::string path = outputDir.empty() ? "." : outputDir;
+		if(!atomic) {
+			dirFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			failed = (dirFd < 0);
+			return;
+		}
+		while(path.size() > 1 && path[path.size() - 1] == '/') {
+			path.erase(path.size() - 1);
+		}
+		const std::string::size_type slash = path.rfind('/');
+		parentDir = (slash == std::string::npos) ? "." : ((slash == 0) ? "/" : path.substr(0, slash));
+		outputName = (slash == std::string::npos) ? path : path.substr(slash + 1);
+		stagingName = "." + outputName + ".staging." + std::to_string(getpid());
+		parentFd = open(parentDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if(parentFd < 0 || outputName.empty() || outputName == "." || outputName == "..") {
+			failed = true;
+			return;
+		}
+		struct stat outputInfo;
+		if(fstatat(parentFd, outputName.c_str(), &outputInfo, 0) == 0) {
+			outputMode = outputInfo.st_mode & 07777;
+			if(!replaceable(parentFd, outputName)) {
+				stagingName.clear();
+				foreign = true;
+				failed = true;
+				return;
+			}
+		}
+		if(mkdirat(parentFd, stagingName.c_str(), 0700) != 0) {
+			stagingName.clear();
+			failed = true;
+			return;
+		}
+		dirFd = openat(parentFd, stagingName.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		failed = (dirFd < 0) || !writeFile(markerName, "", 0);
+	}
+
+
+	~DirectorySink() {
+		closeSubdirectories(false);
+		if(dirFd >= 0) {
+			close(dirFd);
+		}
+		// An unfinished staging directory is thrown away, leaving the published files untouched
+		if(atomic && parentFd >= 0 && !stagingName.empty()) {
+			removeTree(parentFd, stagingName);
+		}
+		if(parentFd >= 0) {
+			close(parentFd);
+		}
+	}
+
+
+	bool isOpen() const {
+		return !failed;
+	}
+
+
+	// Was atomic publication refused because the output directory holds files it did not publish?
+	bool holdsOtherFiles() const {
+		return foreign;
+	}
+
+
+	bool writeFile(const std::string & name, const char * data, uint64_t numBytes) {
+		if(failed) {
+			return false;
+		}
+		int fileDirFd = dirFd;
+		std::string fileName = name;
+		const std::string::size_type slash = name.rfind('/');
+		if(slash != std::string::npos) {
+			fileDirFd = subdirectory(name.substr(0, slash));
+			fileName = name.substr(slash + 1);
+			if(fileDirFd < 0) {
+				return false;
+			}
+		}
+		const int fd = openat(fileDirFd, fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if(fd < 0) {
+			return false;
+		}
+		uint64_t written = 0;
+		while(written < numBytes) {
+			const ssize_t result = write(fd, data + written, numBytes - written);
+			if(result < 0 && errno == EINTR) {
+				continue;
+			}
+			if(result <= 0) {
+				close(fd);
+				return false;
+			}
+			written += result;
+		}
+		// Published files must be on disk before the directory holding them is swapped into place
+		if(atomic && fsync(fd) != 0) {
+			close(fd);
+			return false;
+		}
+		return close(fd) == 0;
+	}
+
+
+	// With atomic publication, syncs the staging directory, swaps it into place and removes the previous output
+	bool finish() {
+		if(failed) {
+			return false;
+		}
+		if(!atomic) {
+			return true;
+		}
+		const bool synced = closeSubdirectories(true) && (fchmod(dirFd, outputMode) == 0) && (fsync(dirFd) == 0);
+		close(dirFd);
+		dirFd = -1;
+		if(!synced) {
+			failed = true;
+			return false;
+		}
+		bool exchanged = false;
+#ifdef RENAME_EXCHANGE
+		exchanged = (renameat2(parentFd, stagingName.c_str(), parentFd, outputName.c_str(), RENAME_EXCHANGE) == 0);
+#endif
+		if(!exchanged) {
+			// Without an atomic exchange, or if there is nothing to exchange with, move any previous output aside
+			// first, and back again if the new output cannot take its place
+			const std::string previousName = stagingName + ".previous";
+			const bool hadPrevious = (renameat(parentFd, outputName.c_str(), parentFd, previousName.c_str()) == 0);
+			if(renameat(parentFd, stagingName.c_str(), parentFd, outputName.c_str()) != 0) {
+				if(hadPrevious) {
+					renameat(parentFd, previousName.c_str(), parentFd, outputName.c_str());
+				}
+				failed = true;
+				return false;
+			}
+			if(hadPrevious && renameat(parentFd, previousName.c_str(), parentFd, stagingName.c_str()) != 0) {
+				removeTree(parentFd, previousName);
+			}
+			if(!hadPrevious) {
+				stagingName.clear();
+			}
+		}
+		fsync(parentFd);
+		// The staging name now holds the previous output, which is removed by the destructor
+		return true;
+	}
+
+
+	std::string describe(const std::string & name) const {
+		std::string path = outputDir.empty() ? "." : outputDir;
+		if(path[path.size() - 1] != '/') {
+			path += '/';
+		}
+		return path + name;
+	}
+
+};
+#endif
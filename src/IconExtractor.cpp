@@ -33,19 +33,367 @@
 #include <string>
 #include <sstream>
 #include <cmath>
+#include <cstring>
+#include <cstdlib>
 #include <utility>
 #include <list>
+#include <vector>
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <chrono>
 
 #include <sys/types.h>
 #include <sys/stat.h>
 
 #include "ConsoleOutput.h"
+#include "MemoryBudget.h"
+#include "SheetBuffer.h"
+#include "InputPipe.h"
+#include "FileSink.h"
+#include "TarSink.h"
+#include "BmpHeader.h"
+#include "IconSink.h"
+#include "BmpSink.h"
+#include "AtlasSink.h"
+#include "CHeaderSink.h"
+#include "MetadataSink.h"
+#include "PackedAtlasSink.h"
+#include "RleSink.h"
+#include "RowDictionarySink.h"
+#include "AnimationSink.h"
+#include "NearDuplicateSink.h"
+#include "PageSink.h"
+#include "PixelFormatSink.h"
+#include "EpaperSink.h"
+#include "DistanceFieldSink.h"
+#include "LvglSink.h"
+#include "BitKernels.h"
+#include "Morphology.h"
 
 using std::cout;
 using std::cin;
 using std::cerr;
 using std::endl;
 
+// Finds the leftmost and rightmost black pixels between columns firstCol and lastCol (inclusive)
+// of one row of normalised bit map data, in which 1 is white and 0 is black.
+// Returns false if every pixel in that range is white.
+static bool findInkInRow(const uint8_t * rowData, unsigned int firstCol, unsigned int lastCol, unsigned int & leftInk, unsigned int & rightInk) {
+	const unsigned int firstByte = firstCol/8;
+	const unsigned int lastByte = lastCol/8;
+	const uint8_t firstByteMask = 0xFF >> (firstCol%8);
+	const uint8_t lastByteMask = 0xFF << (7-(lastCol%8));
+	unsigned int byte = firstByte;
+	uint8_t ink = 0;
+	for(; byte <= lastByte; byte++) {
+		ink = ~(rowData[byte]);
+		ink &= (byte == firstByte) ? firstByteMask : 0xFF;
+		ink &= (byte == lastByte) ? lastByteMask : 0xFF;
+		if(ink) {
+			break;
+		}
+	}
+	if(!ink) {
+		return false;
+	}
+	leftInk = byte*8;
+	for(uint8_t bitmask = 0x80; !(ink & bitmask); bitmask >>= 1) {
+		leftInk++;
+	}
+	for(byte = lastByte; ; byte--) {
+		ink = ~(rowData[byte]);
+		ink &= (byte == firstByte) ? firstByteMask : 0xFF;
+		ink &= (byte == lastByte) ? lastByteMask : 0xFF;
+		if(ink) {
+			break;
+		}
+	}
+	rightInk = (byte*8) + 7;
+	for(uint8_t bitmask = 0x01; !(ink & bitmask); bitmask <<= 1) {
+		rightInk--;
+	}
+	return true;
+}
+
+// Extents of one icon within the bit map, inclusive
+struct iconExtents {
+	unsigned int top;
+	unsigned int bottom;
+	unsigned int left;
+	unsigned int right;
+	// Bounds of the row/column grid cell the icon was found in
+	unsigned int cellTop;
+	unsigned int cellBottom;
+	unsigned int cellLeft;
+	unsigned int cellRight;
+};
+
+// Works out the pixel dimensions of an icon once margins, and any padding out to the size of the largest icon, are added
+static void iconDimensions(const iconExtents & icon, bool sameSizeIcons, uint32_t maxIconWidth, uint32_t maxIconHeight,
+		unsigned int horizontalMargin, unsigned int verticalMargin, uint32_t & iconWidth, uint32_t & iconHeight) {
+	if(sameSizeIcons) {
+		//  maxIconWIdth has already been +1'ed above
+		iconWidth = maxIconWidth + (2*horizontalMargin);
+		iconHeight = maxIconHeight + (2*verticalMargin);
+	}
+	else {
+		// +1 for actual pixel width e.g. an icon from px2 to px6 is 5 pixels wide
+		// 0 1 2 3 4 5 6 7 8 9
+		// - - X X X X X - - -
+		iconWidth = (icon.right - icon.left) + 1 + (2*horizontalMargin);
+		iconHeight = (icon.bottom - icon.top) + 1 + (2*verticalMargin);
+	}
+}
+
+// Works out where the ink of an icon starts within an icon image of the given dimensions. Margins are
+// added to every edge and any extra padding is split evenly, with the odd pixel on the top or left
+static void inkOffsets(const iconExtents & icon, uint32_t iconWidth, uint32_t iconHeight, unsigned int horizontalMargin, unsigned int verticalMargin,
+		unsigned int & inkLeft, unsigned int & inkTop) {
+	inkTop  = verticalMargin   + ceil((double)  ( iconHeight - (2*verticalMargin)  - ((icon.bottom - icon.top) + 1) ) /2 );
+	inkLeft = horizontalMargin + ceil((double)  ( iconWidth - (2*horizontalMargin) - ((icon.right - icon.left) + 1) ) /2 );
+}
+
+// Bytes of memory taken by each icon's extents in a list, with the node's two pointers and the allocator's overhead
+static const uint64_t iconListNodeBytes = sizeof(iconExtents) + (2 * sizeof(void *)) + 16;
+
+// Bytes of memory kept for the icons found on the sheet: the extents of each, held in a list and then a vector,
+// its dimensions the way up it is on the sheet and once turned, and the dimensions and placement of each variant,
+// with room for the copy made while those are grown from one per icon to one per variant
+static uint64_t bytesForIconEntries(uint64_t numIcons, unsigned int numVariants) {
+	return numIcons * (iconListNodeBytes + sizeof(iconExtents) + (4 * sizeof(uint32_t)) + sizeof(iconPlacement) +
+			((uint64_t)(numVariants + 1) * ((2 * sizeof(uint32_t)) + sizeof(iconPlacement))));
+}
+
+// Under a memory limit, narrows the band of bit map rows held so that it fits beside bytesBesideBand, keeping at least
+// minRows rows. A bit map that cannot be read again has to stay whole. Returns false if the band cannot be made to fit.
+static bool fitBand(SheetBuffer & sheet, const MemoryBudget & memoryBudget, uint64_t bytesBesideBand, unsigned int minRows, bool stayingWhole,
+		uint32_t bytesInImageRow) {
+	if(!memoryBudget.isLimited() || sheet.sizeInBytes() + bytesBesideBand <= memoryBudget.bytesForData()) {
+		return true;
+	}
+	const uint64_t rowsLeft = SheetBuffer::rowsWithin(memoryBudget.bytesForData() - std::min(memoryBudget.bytesForData(), bytesBesideBand), bytesInImageRow);
+	if(stayingWhole || rowsLeft < minRows) {
+		return false;
+	}
+	sheet.resize(rowsLeft);
+	return true;
+}
+
+// Makes sure the rows of the bit map containing an icon are held in memory.
+// Reads the whole row of icons if it fits, otherwise starts from the top of the icon
+static bool loadIconRows(SheetBuffer & sheet, const iconExtents & icon, unsigned int imageHeight) {
+	if(sheet.holds(icon.top, icon.bottom)) {
+		return true;
+	}
+	const unsigned int firstRow = ((icon.cellBottom - icon.cellTop) < sheet.capacityRows()) ? icon.cellTop : icon.top;
+	return sheet.load(firstRow, std::min(sheet.capacityRows(), imageHeight - firstRow));
+}
+
+// Fills iconData, ceil(iconWidth/8) bytes per row from top to bottom, with an icon and the white
+// margins and padding around it. The rows of the bit map holding the icon must be resident.
+static void extractIcon(const SheetBuffer & sheet, const iconExtents & icon, uint32_t iconWidth, uint32_t iconHeight,
+		unsigned int horizontalMargin, unsigned int verticalMargin, uint8_t * iconData) {
+	const unsigned int iconArraySize = ceil((double)iconWidth/8) * iconHeight;
+	// as the iconData array will be largely filled by bitwise OR operations it is important to initialise it to zeroes
+	memset(iconData, 0x00, iconArraySize);
+
+	// Add margins to all sides and any additional white padding required if current icon dimensions != max icon dimensions
+	unsigned int whitePixelsAtTop    = 0;
+	unsigned int whitePixelsAtLeft   = 0;
+	inkOffsets(icon, iconWidth, iconHeight, horizontalMargin, verticalMargin, whitePixelsAtLeft, whitePixelsAtTop);
+	unsigned int whitePixelsAtBottom = verticalMargin   + floor((double) ( iconHeight - (2*verticalMargin)  - ((icon.bottom - icon.top) + 1) ) /2 );
+	unsigned int whitePixelsAtRight  = horizontalMargin + floor((double) ( iconWidth - (2*horizontalMargin) - ((icon.right - icon.left) + 1) ) /2 ); // TODO: make sure the padding bits at the end of each line are also 1'ed
+	// add top margin
+	for(unsigned int i=0; i<whitePixelsAtTop*ceil((double)iconWidth/8); i++) {
+		iconData[i] |= 0xFF;
+	}
+
+	// add bottom margin
+	for(unsigned int i = (whitePixelsAtTop + ((icon.bottom - icon.top) + 1)) * ceil((double)iconWidth/8); i<iconArraySize; i++) {
+		iconData[i] |= 0xFF;
+	}
+
+	// add left margin
+	for(unsigned int row=whitePixelsAtTop; row<iconHeight-whitePixelsAtBottom; row++) {
+		unsigned int col = 0;
+		unsigned int currentByte = row * ceil((double)iconWidth/8);
+		while(col<whitePixelsAtLeft) {
+			// Assumes always starting at MSB of icon byte
+			if(whitePixelsAtLeft-col > 7) {
+				iconData[currentByte++] |= 0xFF;
+				col += 8;
+			}
+			else {
+				uint8_t bitmask = ((uint8_t)pow(2,whitePixelsAtLeft-col)-1) << (8-(whitePixelsAtLeft-col));
+				iconData[currentByte++] |= bitmask;
+				col += whitePixelsAtLeft-col;
+			}
+		}
+	}
+
+	// add right margin
+	// this is trickier as it may neither start nor end at the start or end of a byte
+	for(unsigned int row=whitePixelsAtTop; row<iconHeight-whitePixelsAtBottom; row++) {
+		unsigned int col = iconWidth - whitePixelsAtRight;
+		unsigned int currentByte = (row * ceil((double)iconWidth/8)) + floor((double)col/8);
+		unsigned int endOfLineBit = ceil((double)iconWidth/8)*8; // ensures that padding bits at the end of each line are set to 1
+		while(col<endOfLineBit) {
+			uint8_t bitmask = pow(2,8-(col%8))-1;
+			iconData[currentByte++] |= bitmask;
+			col += 8-(col%8);
+		}
+	}
+
+	// The magic happens here:
+	// Copy and bitshift all pixels from the defined "icon" regions in the original bitmap to the new individual icon files
+	for(unsigned int iconRow = whitePixelsAtTop; iconRow < iconHeight-whitePixelsAtBottom; iconRow++) {
+		unsigned int iconCol = whitePixelsAtLeft;
+		unsigned int bitmapRow = icon.top + (iconRow - whitePixelsAtTop);
+		unsigned int bitmapCol = icon.left;
+		unsigned int currentIconByte = (iconRow * ceil((double)iconWidth/8)) + floor((double)iconCol/8);
+		const uint8_t * bitmapRowData = sheet.row(bitmapRow);
+		unsigned int currentBitmapByte = floor((double)bitmapCol/8);
+		while(iconCol < iconWidth-whitePixelsAtRight) {
+			uint8_t bitInBitmapByte = (bitmapCol%8);	// 0->7, msb->lsb
+			uint8_t bitInIconByte = (iconCol%8); 		// 0->7, msb->lsb
+			// number of bits to copy must be lt or eq to bits remaining in current icon byte
+			// number of bits to copy must be lt or eq to bits remaining in current bitmap byte
+			// number of bits to copy must be lt or eq to bits remaining on current line
+			uint8_t numBitsToCopy = 0;
+			unsigned int numBitsLeftOnRow = ((iconWidth-whitePixelsAtRight)-iconCol);
+			uint8_t bitsLeftInIconByte = 8-bitInIconByte;	// Max number of bits possible to copy from bitmapData to iconData in next operation
+			uint8_t bitsLeftInBitmapByte = 8-bitInBitmapByte; // Number of bits left to copy from current bitmap byte
+			numBitsToCopy = (bitsLeftInIconByte > bitsLeftInBitmapByte) ? bitsLeftInBitmapByte : bitsLeftInIconByte;
+			numBitsToCopy = (numBitsToCopy < numBitsLeftOnRow ) ? numBitsToCopy : numBitsLeftOnRow;
+			// Construct a bitmask containing the bits to copy from bitmapData to iconData
+			uint8_t bitmask = 0x00;
+			uint8_t bitsToCopy = bitmapRowData[currentBitmapByte];
+			// e.g. need to write bits     --XXX--- to icon data (making this example work, with 4 remaining but 3 to copy, should ensure end of line compatibility)
+			// from a bitmapByte with bits ----XXXX remaining
+			// Zero any already-copied bits in the bitsToCopy byte
+			bitmask = pow(2,bitsLeftInBitmapByte)-1; // WAS: bitmask = pow(2,bitInBitmapByte)-1; // WAS: bitmask = pow(2,bitInBitmapByte+1)-1;
+			bitsToCopy &= bitmask;
+			if(numBitsToCopy < bitsLeftInBitmapByte) {
+					bitmask = pow(2,bitsLeftInBitmapByte-numBitsToCopy)-1;
+					bitsToCopy ^= bitmask;
+			}
+			// Shift the bitsToCopy left OR right depending on where the iconCol is relative to the bitmapCol
+			// NB: left shift by a negative number is undefined behaviour in C++
+			if(bitInIconByte < bitInBitmapByte) {
+				bitsToCopy = bitsToCopy << (bitInBitmapByte - bitInIconByte);
+			}
+			else {
+				bitsToCopy = bitsToCopy >> (bitInIconByte - bitInBitmapByte);
+			}
+			// Update iconData - at last...
+			iconData[currentIconByte] |= bitsToCopy;
+
+			// Update all counter variables ready for next iteration
+			// Neither the currentIconByte nor the currentBitmapByte necessarily increment after a copy operation
+			if(bitsLeftInIconByte - numBitsToCopy == 0) {
+				currentIconByte++;
+			}
+			if(bitsLeftInBitmapByte - numBitsToCopy == 0) {
+				currentBitmapByte++;
+			}
+			iconCol += numBitsToCopy;
+			bitmapCol += numBitsToCopy;
+		}
+	}
+}
+
+// Moves the top left corner of an image placed at x,y within an area to where it ends up when the area
+// is turned clockwise by a number of quarter turns
+static void turnPlacement(int32_t & x, int32_t & y, uint32_t width, uint32_t height, uint32_t areaWidth, uint32_t areaHeight, unsigned int quarterTurns) {
+	const int32_t left = x;
+	const int32_t top = y;
+	if(quarterTurns == 1) {
+		x = (int32_t)areaHeight - top - (int32_t)height;
+		y = left;
+	}
+	else if(quarterTurns == 2) {
+		x = (int32_t)areaWidth - left - (int32_t)width;
+		y = (int32_t)areaHeight - top - (int32_t)height;
+	}
+	else if(quarterTurns == 3) {
+		x = top;
+		y = (int32_t)areaWidth - left - (int32_t)width;
+	}
+}
+
+// Turns an extracted icon clockwise by a number of quarter turns, then flips it left to right if mirroring.
+// The dimensions are those of the icon the way up it is on the sheet. Works between iconData and scratch,
+// which must each have room for the icon either way up, and returns whichever of them holds the result.
+static uint8_t * orientIcon(uint8_t * iconData, uint8_t * scratch, uint32_t sheetWidth, uint32_t sheetHeight, unsigned int quarterTurns, bool mirror) {
+	if(quarterTurns != 0) {
+		BitKernels::rotate(iconData, sheetWidth, sheetHeight, quarterTurns, scratch);
+		std::swap(iconData, scratch);
+	}
+	if(mirror) {
+		BitKernels::mirror(iconData, ((quarterTurns % 2 == 1) ? sheetHeight : sheetWidth), ((quarterTurns % 2 == 1) ? sheetWidth : sheetHeight), scratch);
+		std::swap(iconData, scratch);
+	}
+	return iconData;
+}
+
+// Extracts icons first to last-1 straight into their slots in the atlas, turned, mirrored and in the bit
+// order asked for. The dimensions are those of the icons the way up they are on the sheet. Run on several
+// threads at once, each with its own range of icons, when the whole bit map is held in memory.
+static void extractIconsIntoAtlas(const SheetBuffer & sheet, const std::vector<iconExtents> & icons, const std::vector<uint32_t> & iconWidths,
+		const std::vector<uint32_t> & iconHeights, unsigned int horizontalMargin, unsigned int verticalMargin, unsigned int quarterTurns,
+		bool mirror, bool lsbFirst, AtlasSink & atlas, unsigned int first, unsigned int last) {
+	const bool orienting = (quarterTurns != 0 || mirror);
+	uint64_t largestIconArraySize = 0;
+	for(unsigned int i = first; i < last && orienting; i++) {
+		largestIconArraySize = std::max(largestIconArraySize, std::max(AtlasSink::bytesForIcon(iconWidths[i], iconHeights[i]), AtlasSink::bytesForIcon(iconHeights[i], iconWidths[i])));
+	}
+	uint8_t * iconBuffers = orienting ? new uint8_t[2 * largestIconArraySize] : NULL;
+	for(unsigned int i = first; i < last; i++) {
+		uint8_t * slot = atlas.slot(i);
+		const uint64_t iconArraySize = AtlasSink::bytesForIcon(iconWidths[i], iconHeights[i]);
+		if(orienting) {
+			extractIcon(sheet, icons[i], iconWidths[i], iconHeights[i], horizontalMargin, verticalMargin, iconBuffers);
+			memcpy(slot, orientIcon(iconBuffers, iconBuffers + largestIconArraySize, iconWidths[i], iconHeights[i], quarterTurns, mirror),
+					((quarterTurns % 2 == 1) ? AtlasSink::bytesForIcon(iconHeights[i], iconWidths[i]) : iconArraySize));
+		}
+		else {
+			extractIcon(sheet, icons[i], iconWidths[i], iconHeights[i], horizontalMargin, verticalMargin, slot);
+		}
+		if(lsbFirst) {
+			BitKernels::reverseBitOrder(slot, ((quarterTurns % 2 == 1) ? AtlasSink::bytesForIcon(iconHeights[i], iconWidths[i]) : iconArraySize), slot);
+		}
+	}
+	delete[] iconBuffers;
+}
+
+// Does an output format write raw pixel data, which --lsbfirst hands it least significant bit first?
+static bool takesLsbFirst(const std::string & format) {
+	return (format == "atlas" || format == "header" || format == "meta" || format == "rle" || format == "rowdict");
+}
+
+// Reads a colour given as RRGGBB or RRGGBBAA in hexadecimal, optionally after a '#', into 0xRRGGBBAA.
+// Colours without alpha are opaque
+static bool parseColour(const std::string & text, uint32_t & colour) {
+	const std::string digits = (!text.empty() && text[0] == '#') ? text.substr(1) : text;
+	if((digits.size() != 6 && digits.size() != 8) || digits.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+		return false;
+	}
+	colour = strtoul(digits.c_str(), NULL, 16);
+	if(digits.size() == 6) {
+		colour = (colour << 8) | 0xFF;
+	}
+	return true;
+}
+
+// Deletes every output, abandoning any that have not been finished
+static void deleteIconOutputs(std::vector<IconSink *> & iconOutputs) {
+	for(unsigned int output = 0; output < iconOutputs.size(); output++) {
+		delete iconOutputs[output];
+	}
+	iconOutputs.clear();
+}
+
 int main(int argc, char * argv[]) {
 	// Variables to be set by command line args
 	// Verbose output?
@@ -56,12 +404,79 @@ int main(int argc, char * argv[]) {
 	bool addMargins = false;
 	unsigned int horizontalMargin = 0;
 	unsigned int verticalMargin = 0;
+	// Store each icon trimmed to its ink, recording where it sits in the cell it would otherwise be padded out to
+	bool trimIcons = false;
 	// Input file (Must be a one-bit-per-pixel bitmap file)
 	std::string inputFile;
 	bool inputFileSpecified = false;
-	// Output folder (Directory into which to place the icon files created by this program)
-	std::string outputDir = "";
-	bool outputDirSpecified = false;
+	// Outputs, as pairs of format and target. Every icon is extracted once and written to all of them
+	//   bmp:<directory>    Individual bitmap files in a directory (-o <directory>)
+	//   tar:<file>         Individual bitmap files in a tar archive, "-" for standard output (--tar <file>)
+	//   atlas:<file>       One file holding an index and the pixel data of every icon (--atlas <file>)
+	//   header:<file>      C header with every icon as a byte array
+	//   meta:<file>        Table of every icon's size, position within its cell and CRC-32C checksum
+	//   packed:<file>      Every icon repacked into one small bitmap, with a table of coordinates in <file>.csv
+	//   rle:<file>         One indexed file with the rows of every icon compressed by PackBits
+	//   rowdict:<file>     One file with every icon as references to a shared dictionary of distinct rows
+	//   anim:<file>        Each row of icons as animation frames, with only the lines that change as LCD commands
+	//   neardup:<file>     Table of the pairs of same sized icons that differ in only a few pixels
+	//   pages:<file>       One indexed file with every icon in the vertical byte pages of SSD1306 style OLED controllers
+	//   a8:<file>          One indexed file with every icon as a byte of coverage per pixel
+	//   rgb565:<file>      One indexed file with every icon as 16 bit RGB565 pixels in the foreground and background colours
+	//   rgba8888:<file>    One indexed file with every icon as 32 bit RGBA pixels in the foreground and background colours
+	//   epd2:<file>        One indexed file with every icon as packed two bit e-paper pixels
+	//   epdplanes:<file>   One indexed file with every icon as the two bit planes of two bit e-paper pixels
+	//   sdf:<file>         Signed distance fields of every icon packed into one greyscale PGM, with a table in <file>.csv
+	//   lvgl:<directory>   C sources of LVGL image descriptors with LV_IMG_CF_INDEXED_1BIT data, and a header declaring them
+	//   lvglalpha:<directory> C sources of LVGL image descriptors with LV_IMG_CF_ALPHA_1BIT data, and a header declaring them
+	std::vector<std::pair<std::string, std::string>> outputs;
+	// Spread icon files across this many hashed subdirectories of the output (0 keeps them all together)
+	unsigned int numOutputShards = 0;
+	// Publish the output directory atomically, by writing into a staging directory and swapping it into place.
+	// The directory is replaced as a whole, so it must be empty or hold an earlier atomic output
+	bool atomicOutput = false;
+	// Write the smallest valid headers to each icon file instead of a copy of the input file's headers
+	bool minimalHeaders = false;
+	// Start every icon in a packed atlas on a byte boundary
+	bool byteAlignedPacking = false;
+	// Largest number of differing pixels for two icons to be reported as near duplicates
+	unsigned int nearDuplicateDistance = 2;
+	// Turn every icon clockwise by this many degrees (0, 90, 180 or 270) before writing it out
+	unsigned int rotationDegrees = 0;
+	// Colours of the ink and the background in the rgb565, rgba8888 and lvgl outputs, as 0xRRGGBBAA. Taken from
+	// the input file's colour table unless given on the command line
+	uint32_t foregroundColour = 0;
+	uint32_t backgroundColour = 0;
+	bool foregroundColourSpecified = false;
+	bool backgroundColourSpecified = false;
+	// Two bit codes for ink and background in the epd2 and epdplanes outputs
+	unsigned int epaperInkCode = 0;
+	unsigned int epaperBackgroundCode = 3;
+	// Distance in pixels that signed distance fields extend beyond the icons, and the factor they are reduced by
+	unsigned int distanceFieldSpread = 4;
+	unsigned int distanceFieldDownscale = 1;
+	// Number of icons in each C source of the lvgl and lvglalpha outputs
+	unsigned int lvglIconsPerSource = 64;
+	// Write every icon at each of these whole number scales, as consecutive icons with names such as 0001@2x
+	std::vector<unsigned int> scaleFactors(1, 1);
+	// Flip every icon left to right, after turning it
+	bool mirrorIcons = false;
+	// Also write every icon emboldened, grown by a pixel on every side, with names such as 0001@bold
+	bool boldVariants = false;
+	// Clean up the bit map before the icons are looked for: specks removes isolated ink pixels, open and close
+	// open or close the ink with a 3x3 square. The whole bit map must fit within the maximum memory
+	std::string denoiseOperation;
+	// Write the raw pixel data of the atlas, header, rle and rowdict outputs, and checksum it in the metadata,
+	// least significant bit first. Bitmap files, and the pages and anim formats, keep their own bit order
+	bool lsbFirst = false;
+	// Upper limit on the memory used by the program (Bitmaps too large to hold in memory are then read in bands of rows)
+	MemoryBudget memoryBudget;
+	// Method used to read the pixel array of the input file
+	SheetBuffer::readMethod_t readMethod = SheetBuffer::READ_IFSTREAM;
+	std::string readMethodName = "ifstream";
+	// Compression applied to the input file. Guessed from the file name unless given on the command line
+	InputPipe::compression_t inputCompression = InputPipe::NONE;
+	bool inputCompressionSpecified = false;
 	// Create object for formatted console error and information output
 	ConsoleOutput bitmapInfo(78, '-');
 
@@ -86,6 +501,10 @@ int main(int argc, char * argv[]) {
 				else {
 					inputFile = argv[++i];
 					inputFileSpecified = true;
+					// "-" reads the bitmap from standard input
+					if(inputFile == "-") {
+						continue;
+					}
 					struct stat pathInfo;
 					int result = stat(inputFile.c_str(), &pathInfo);
 					if(result != 0) {
@@ -106,19 +525,154 @@ int main(int argc, char * argv[]) {
 					return false;
 				}
 				else {
-					outputDir = argv[++i];
-					outputDirSpecified = true;
-					struct stat pathInfo;
-					if(stat(outputDir.c_str(), &pathInfo) != 0) {
-						bitmapInfo.printMessage(ConsoleOutput::ERR, "Path for output directory does not exist. Path provided is", outputDir);
-						return false;
-					}
-					else if( (pathInfo.st_mode & S_IFDIR) != S_IFDIR ) {
-						bitmapInfo.printMessage(ConsoleOutput::ERR, "Path provided for output directory is not a directory. Path provided is", outputDir);
-						return false;
+					outputs.push_back(std::make_pair(std::string("bmp"), std::string(argv[++i])));
+				}
+			}
+			// Argument for specifying an output archive
+			else if(std::string(argv[i]) == "--tar") {
+				if(i+1 == argc) {	// "--tar" need an additional argument to hold a filename
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Command line argument error: No output archive specified", "");
+					return false;
+				}
+				outputs.push_back(std::make_pair(std::string("tar"), std::string(argv[++i])));
+			}
+			// Argument for specifying an output atlas
+			else if(std::string(argv[i]) == "--atlas") {
+				if(i+1 == argc) {	// "--atlas" need an additional argument to hold a filename
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Command line argument error: No output atlas specified", "");
+					return false;
+				}
+				outputs.push_back(std::make_pair(std::string("atlas"), std::string(argv[++i])));
+			}
+			// Argument for adding an output of any format, as format:target
+			else if(std::string(argv[i]) == "--output") {
+				const std::string outputSpec = (i+1 < argc) ? argv[++i] : "";
+				const std::string::size_type colon = outputSpec.find(':');
+				if(colon == std::string::npos) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected an output in the form format:target. Received", outputSpec, "instead");
+					return false;
+				}
+				outputs.push_back(std::make_pair(outputSpec.substr(0, colon), outputSpec.substr(colon + 1)));
+			}
+			// Argument for spreading icon files across hashed subdirectories
+			else if(std::string(argv[i]) == "--shard") {
+				std::istringstream argChecker((i+1 < argc) ? argv[++i] : "");
+				if (!(argChecker >> numOutputShards) || numOutputShards > 65536) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected positive integer number of subdirectories of no more than 65536 for sharding. Received", argChecker.str(), "instead");
+					return false;
+				}
+			}
+			// Argument for publishing the output directory atomically
+			else if(std::string(argv[i]) == "--atomic") {
+				atomicOutput = true;
+			}
+			// Argument for writing minimal headers to the icon files
+			else if(std::string(argv[i]) == "--minheader") {
+				minimalHeaders = true;
+			}
+			// Argument for starting every icon in a packed atlas on a byte boundary
+			else if(std::string(argv[i]) == "--bytealign") {
+				byteAlignedPacking = true;
+			}
+			// Argument for the number of differing pixels allowed between near duplicates
+			else if(std::string(argv[i]) == "--neardistance") {
+				std::istringstream argChecker((i+1 < argc) ? argv[++i] : "");
+				if (!(argChecker >> nearDuplicateDistance) || nearDuplicateDistance > 1024) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected positive integer number of pixels of no more than 1024 for near duplicates. Received", argChecker.str(), "instead");
+					return false;
+				}
+			}
+			// Argument for turning the icons
+			else if(std::string(argv[i]) == "--rotate") {
+				std::istringstream argChecker((i+1 < argc) ? argv[++i] : "");
+				if (!(argChecker >> rotationDegrees) || (rotationDegrees % 90) != 0 || rotationDegrees > 270) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected one of 0, 90, 180 or 270 degrees for the rotation. Received", argChecker.str(), "instead");
+					return false;
+				}
+			}
+			// Argument for the scales to write every icon at, as a comma separated list
+			else if(std::string(argv[i]) == "--scale") {
+				const std::string scaleList = (i+1 < argc) ? argv[++i] : "";
+				std::istringstream listReader(scaleList);
+				std::string scale;
+				scaleFactors.clear();
+				while(std::getline(listReader, scale, ',')) {
+					std::istringstream argChecker(scale);
+					unsigned int factor = 0;
+					if (!(argChecker >> factor) || !argChecker.eof() || factor < 1 || factor > 8 || std::find(scaleFactors.begin(), scaleFactors.end(), factor) != scaleFactors.end()) {
+						scaleFactors.clear();
+						break;
 					}
+					scaleFactors.push_back(factor);
+				}
+				if(scaleFactors.empty()) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected a comma separated list of different scales from 1 to 8. Received", scaleList, "instead");
+					return false;
+				}
+			}
+			// Arguments for the colours of expanded pixel formats
+			else if(std::string(argv[i]) == "--foreground" || std::string(argv[i]) == "--background") {
+				const bool foreground = (std::string(argv[i]) == "--foreground");
+				const std::string colourSpec = (i+1 < argc) ? argv[++i] : "";
+				if(!parseColour(colourSpec, (foreground ? foregroundColour : backgroundColour))) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected a colour as hexadecimal RRGGBB or RRGGBBAA. Received", colourSpec, "instead");
+					return false;
+				}
+				(foreground ? foregroundColourSpecified : backgroundColourSpecified) = true;
+			}
+			// Argument for the e-paper pixel codes of ink and background
+			else if(std::string(argv[i]) == "--epdcodes") {
+				std::istringstream argChecker((i+1 < argc) ? argv[++i] : "");
+				char separator = 0;
+				if (!(argChecker >> epaperInkCode >> separator >> epaperBackgroundCode) || separator != ',' || !argChecker.eof() || epaperInkCode > 3 || epaperBackgroundCode > 3) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected two bit pixel codes for ink and background as ink,background, e.g. 0,3. Received", argChecker.str(), "instead");
+					return false;
+				}
+			}
+			// Argument for the spread of signed distance fields
+			else if(std::string(argv[i]) == "--sdfspread") {
+				std::istringstream argChecker((i+1 < argc) ? argv[++i] : "");
+				if (!(argChecker >> distanceFieldSpread) || distanceFieldSpread < 1 || distanceFieldSpread > 255) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected positive integer number of pixels from 1 to 255 for the distance field spread. Received", argChecker.str(), "instead");
+					return false;
+				}
+			}
+			// Argument for the reduction of signed distance fields
+			else if(std::string(argv[i]) == "--sdfdownscale") {
+				std::istringstream argChecker((i+1 < argc) ? argv[++i] : "");
+				if (!(argChecker >> distanceFieldDownscale) || distanceFieldDownscale < 1 || distanceFieldDownscale > 64) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected positive integer factor from 1 to 64 for the distance field downscale. Received", argChecker.str(), "instead");
+					return false;
+				}
+			}
+			// Argument for the number of icons in each LVGL source
+			else if(std::string(argv[i]) == "--lvglchunk") {
+				std::istringstream argChecker((i+1 < argc) ? argv[++i] : "");
+				if (!(argChecker >> lvglIconsPerSource) || lvglIconsPerSource < 1) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected positive integer number of icons in each LVGL source. Received", argChecker.str(), "instead");
+					return false;
+				}
+			}
+			// Argument for mirroring the icons
+			else if(std::string(argv[i]) == "--mirror") {
+				mirrorIcons = true;
+			}
+			// Argument for also writing emboldened icons
+			else if(std::string(argv[i]) == "--bold") {
+				boldVariants = true;
+			}
+			// Argument for cleaning up the bit map before the icons are looked for
+			else if(std::string(argv[i]) == "--denoise") {
+				denoiseOperation = (i+1 < argc) ? argv[++i] : "";
+				if(denoiseOperation != "specks" && denoiseOperation != "open" && denoiseOperation != "close") {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected one of specks, open or close for the denoise operation. Received", denoiseOperation, "instead");
+					return false;
 				}
 			}
+			// Argument for writing raw pixel data least significant bit first
+			else if(std::string(argv[i]) == "--lsbfirst") {
+				lsbFirst = true;
+			}
 			// Argument for printing verbose output to console
 			else if(std::string(argv[i]) == "-v") {
 				verbose = true;
@@ -127,6 +681,10 @@ int main(int argc, char * argv[]) {
 			else if(std::string(argv[i]) == "--samesize") {
 				sameSizeIcons = true;
 			}
+			// Argument for storing icons trimmed to their ink
+			else if(std::string(argv[i]) == "--trim") {
+				trimIcons = true;
+			}
 			// Argument for adding horizontal margin (extra pixels above and below each icon)
 			else if(std::string(argv[i]) == "--hmargin") {
 				std::istringstream argChecker(argv[++i]);
@@ -145,6 +703,54 @@ int main(int argc, char * argv[]) {
 				}
 				addMargins = true;
 			}
+			// Argument for limiting the memory used by the program, in mebibytes
+			else if(std::string(argv[i]) == "--maxmemory") {
+				std::istringstream argChecker((i+1 < argc) ? argv[++i] : "");
+				unsigned int maxMemoryMiB = 0;
+				if (!(argChecker >> maxMemoryMiB) || maxMemoryMiB == 0) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected positive integer number of mebibytes for maximum memory. Received", argChecker.str(), "instead");
+					return false;
+				}
+				memoryBudget.setLimit((uint64_t)maxMemoryMiB * 1024 * 1024);
+			}
+			// Argument for choosing how the pixel array is read from the input file
+			else if(std::string(argv[i]) == "--reader") {
+				readMethodName = (i+1 < argc) ? argv[++i] : "";
+				if(readMethodName == "ifstream") {
+					readMethod = SheetBuffer::READ_IFSTREAM;
+				}
+				else if(readMethodName == "mmap") {
+					readMethod = SheetBuffer::READ_MMAP;
+				}
+				else if(readMethodName == "sequential") {
+					readMethod = SheetBuffer::READ_SEQUENTIAL;
+				}
+				else if(readMethodName == "direct") {
+					readMethod = SheetBuffer::READ_DIRECT;
+				}
+				else {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected one of ifstream, mmap, sequential or direct for the reader. Received", readMethodName, "instead");
+					return false;
+				}
+			}
+			// Argument for decompressing the input file, overriding the guess made from its name
+			else if(std::string(argv[i]) == "--decompress") {
+				const std::string compressionName = (i+1 < argc) ? argv[++i] : "";
+				if(compressionName == "none") {
+					inputCompression = InputPipe::NONE;
+				}
+				else if(compressionName == "gzip") {
+					inputCompression = InputPipe::GZIP;
+				}
+				else if(compressionName == "zstd") {
+					inputCompression = InputPipe::ZSTD;
+				}
+				else {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected one of none, gzip or zstd for decompression. Received", compressionName, "instead");
+					return false;
+				}
+				inputCompressionSpecified = true;
+			}
 			// Argument for printing help text
 			else if(std::string(argv[i]) == "-h") {
 				// TODO: Write help text, or execute function to print help text
@@ -166,6 +772,80 @@ int main(int argc, char * argv[]) {
 		return false;
 	}
 
+	// Icon files are written to the current directory if no output has been given
+	const bool outputSpecified = !outputs.empty();
+	if(!outputSpecified) {
+		outputs.push_back(std::make_pair(std::string("bmp"), std::string("")));
+	}
+	bool outputDirSpecified = false;
+	bool standardOutputUsed = false;
+	for(unsigned int output = 0; output < outputs.size(); output++) {
+		const std::string & format = outputs[output].first;
+		const std::string & target = outputs[output].second;
+		if(format != "bmp" && format != "tar" && format != "atlas" && format != "header" && format != "meta" && format != "packed" && format != "rle" && format != "rowdict" && format != "anim" && format != "neardup" && format != "pages"
+				&& format != "a8" && format != "rgb565" && format != "rgba8888" && format != "epd2" && format != "epdplanes" && format != "sdf"
+				&& format != "lvgl" && format != "lvglalpha") {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected one of bmp, tar, atlas, header, meta, packed, rle, rowdict, anim, neardup, pages, a8, rgb565, rgba8888, epd2, epdplanes, sdf, lvgl or lvglalpha for the output format. Received", format, "instead");
+			return false;
+		}
+		if(format == "bmp") {
+			if(target.empty()) {
+				continue;
+			}
+			outputDirSpecified = true;
+			struct stat pathInfo;
+			if(stat(target.c_str(), &pathInfo) != 0) {
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Path for output directory does not exist. Path provided is", target);
+				return false;
+			}
+			else if( (pathInfo.st_mode & S_IFDIR) != S_IFDIR ) {
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Path provided for output directory is not a directory. Path provided is", target);
+				return false;
+			}
+		}
+		else if(target.empty()) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "No file specified for the output of format", format);
+			return false;
+		}
+		else if(target == "-") {
+			if(format != "tar" || standardOutputUsed) {
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Only a single tar archive can be written to standard output", "");
+				return false;
+			}
+			standardOutputUsed = true;
+		}
+		else if(format == "lvgl" || format == "lvglalpha") {
+			struct stat pathInfo;
+			if(stat(target.c_str(), &pathInfo) != 0 || (pathInfo.st_mode & S_IFDIR) != S_IFDIR) {
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Path provided for LVGL sources is not an existing directory. Path provided is", target);
+				return false;
+			}
+		}
+	}
+	if(atomicOutput && !outputDirSpecified) {
+		bitmapInfo.printMessage(ConsoleOutput::ERR, "Atomic publication requires an output directory to be specified with -o", "");
+		return false;
+	}
+	// The archive owns standard output, so send console output to standard error instead
+	if(standardOutputUsed) {
+		cout.rdbuf(cerr.rdbuf());
+	}
+	// Without an output that takes raw pixel data there is nothing to write least significant bit first
+	bool lsbFirstTaken = false;
+	for(unsigned int output = 0; output < outputs.size(); output++) {
+		lsbFirstTaken = lsbFirstTaken || takesLsbFirst(outputs[output].first);
+	}
+	if(lsbFirst && !lsbFirstTaken) {
+		bitmapInfo.printMessage(ConsoleOutput::WARN, "None of the outputs takes raw pixel data, which only atlas, header, meta, rle and rowdict do. Ignoring", "--lsbfirst");
+		lsbFirst = false;
+	}
+
+	if(!inputCompressionSpecified) {
+		inputCompression = InputPipe::compressionFromName(inputFile);
+	}
+	// Standard input and compressed files can only be read once, from start to finish
+	const bool streamedInput = (inputFile == "-") || (inputCompression != InputPipe::NONE);
+
 	if(verbose) {
 		bitmapInfo.printHeading("Icon Extractor");
 	}
@@ -173,13 +853,75 @@ int main(int argc, char * argv[]) {
 	if(verbose) {
 		cout << endl;
 		bitmapInfo.printHeading("Summary of command line arguments");
-		bitmapInfo.printMessage(ConsoleOutput::INFO, "Input file is", inputFile);
-		if(outputDirSpecified) {
-			bitmapInfo.printMessage(ConsoleOutput::INFO, "Output directory is", outputDir);
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Input file is", ((inputFile == "-") ? "standard input" : inputFile));
+		if(inputCompression != InputPipe::NONE) {
+			bitmapInfo.printMessage(ConsoleOutput::INFO, "Input file will be decompressed with", ((inputCompression == InputPipe::GZIP) ? "gzip" : "zstd"));
 		}
-		else {
+		if(!outputSpecified) {
 			bitmapInfo.printMessage(ConsoleOutput::INFO, "No output directory has been specified", "");
 		}
+		for(unsigned int output = 0; outputSpecified && output < outputs.size(); output++) {
+			const std::string & format = outputs[output].first;
+			const std::string & target = outputs[output].second;
+			if(format == "bmp") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output directory is", (target.empty() ? "the current directory" : target));
+			}
+			else if(format == "tar") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output archive is", ((target == "-") ? "standard output" : target));
+			}
+			else if(format == "atlas") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output atlas is", target);
+			}
+			else if(format == "header") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output C header is", target);
+			}
+			else if(format == "meta") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output metadata table is", target);
+			}
+			else if(format == "rle") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output run length encoded icons are", target);
+			}
+			else if(format == "rowdict") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output row dictionary is", target);
+			}
+			else if(format == "anim") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output animation is", target);
+			}
+			else if(format == "neardup") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output near duplicate report is", target);
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Largest number of differing pixels between near duplicates is", nearDuplicateDistance);
+			}
+			else if(format == "pages") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output OLED pages are", target);
+			}
+			else if(format == "a8" || format == "rgb565" || format == "rgba8888") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, ((format == "a8") ? "Output 8 bit alpha pixels are" : ((format == "rgb565") ? "Output RGB565 pixels are" : "Output RGBA8888 pixels are")), target);
+			}
+			else if(format == "epd2" || format == "epdplanes") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, ((format == "epd2") ? "Output packed e-paper pixels are" : "Output e-paper bit planes are"), target);
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "E-paper pixel code of ink is", epaperInkCode);
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "E-paper pixel code of background is", epaperBackgroundCode);
+			}
+			else if(format == "sdf") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output signed distance fields are", target);
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Distance fields extend beyond the icons by", distanceFieldSpread, "pixels");
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Distance fields are reduced by a factor of", distanceFieldDownscale);
+			}
+			else if(format == "lvgl" || format == "lvglalpha") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, ((format == "lvgl") ? "Output LVGL indexed images are in" : "Output LVGL alpha images are in"), target);
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Number of icons in each LVGL source is", lvglIconsPerSource);
+			}
+			else if(format == "packed") {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Output packed atlas is", target);
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Byte alignment of icons in the packed atlas is set to", ((byteAlignedPacking) ? "true" : "false") );
+			}
+		}
+		if(outputDirSpecified) {
+			bitmapInfo.printMessage(ConsoleOutput::INFO, "Atomic publication of the output directory is set to", ((atomicOutput) ? "true" : "false") );
+		}
+		if(numOutputShards > 1) {
+			bitmapInfo.printMessage(ConsoleOutput::INFO, "Icon files will be spread across subdirectories numbering", numOutputShards);
+		}
 		bitmapInfo.printMessage(ConsoleOutput::INFO, "Verbose output option is set to", ((verbose) ? "true" : "false") );
 		bitmapInfo.printMessage(ConsoleOutput::INFO, "Add margins option is set to", ((addMargins) ? "true" : "false") );
 		if(addMargins) {
@@ -187,6 +929,22 @@ int main(int argc, char * argv[]) {
 			bitmapInfo.printMessage(ConsoleOutput::INFO, "Vertical margin is set to", verticalMargin, "pixels");
 		}
 		bitmapInfo.printMessage(ConsoleOutput::INFO, "Option to pad out all icon files to the same dimensions is set to", ((sameSizeIcons) ? "true" : "false") );
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Option to store icons trimmed to their ink is set to", ((trimIcons) ? "true" : "false") );
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Option to write minimal headers to the icon files is set to", ((minimalHeaders) ? "true" : "false") );
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Icons will be turned clockwise by", rotationDegrees, "degrees");
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Option to mirror the icons left to right is set to", ((mirrorIcons) ? "true" : "false") );
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Option to also write emboldened icons is set to", ((boldVariants) ? "true" : "false") );
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Bit map will be denoised before detection with the operation", (denoiseOperation.empty() ? "none" : denoiseOperation.c_str()));
+		std::string scaleList;
+		for(unsigned int scale = 0; scale < scaleFactors.size(); scale++) {
+			scaleList += ((scale > 0) ? "," : "") + std::to_string(scaleFactors[scale]);
+		}
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Icons will be written at the scales", scaleList);
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Option to write raw pixel data least significant bit first is set to", ((lsbFirst) ? "true" : "false") );
+		if(memoryBudget.isLimited()) {
+			bitmapInfo.printMessage(ConsoleOutput::INFO, "Maximum memory is set to", memoryBudget.limit() / (1024*1024), "MiB");
+		}
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Pixel data will be read using the reader", readMethodName);
 	}
 
 	if(verbose) {
@@ -196,9 +954,20 @@ int main(int argc, char * argv[]) {
 
 
 	// Open file specified in command line args
+	// Streamed input is read through a pipe, from standard input or from the decompressor
 	std::ifstream bitmapFile;
-	bitmapFile.open(inputFile, (std::ifstream::in | std::ifstream::binary));
-	if(bitmapFile.fail()) {
+	InputPipe inputPipe;
+	if(streamedInput) {
+		if(!inputPipe.open(inputFile, inputCompression)) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed to open input file, or to start its decompressor, for", inputFile);
+			cout << endl;
+			return false;
+		}
+	}
+	else {
+		bitmapFile.open(inputFile, (std::ifstream::in | std::ifstream::binary));
+	}
+	if(!streamedInput && bitmapFile.fail()) {
 		bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed to open input file", inputFile);
 		cout << endl;
 		return false;
@@ -208,39 +977,51 @@ int main(int argc, char * argv[]) {
 			bitmapInfo.printMessage(ConsoleOutput::INFO, "File", inputFile, "opened");
 		}
 	}
+	std::istream & bitmapStream = streamedInput ? inputPipe.input() : bitmapFile;
 
 	// get bitmapFile size
-	bitmapFile.seekg(0, bitmapFile.end);
-	const unsigned int bitmapFileSize = bitmapFile.tellg();
-	bitmapFile.seekg(0, bitmapFile.beg);
+	// The size of a stream is not known until it has been read, so the size declared within the file is used instead
+	unsigned int bitmapFileSize = 0;
+	if(!streamedInput) {
+		bitmapFile.seekg(0, bitmapFile.end);
+		bitmapFileSize = bitmapFile.tellg();
+		bitmapFile.seekg(0, bitmapFile.beg);
+	}
 
 	if(verbose) {
 		cout << endl;
 		bitmapInfo.printHeading("Bitmap File Header Information:");
 	}
 
-	if(bitmapFileSize < 54) {
+	if(!streamedInput && bitmapFileSize < 54) {
 		bitmapInfo.printMessage(ConsoleOutput::ERR,	"Bitmap file is too small to contain minimum required file headers. File is", bitmapFileSize, "bytes");
 		bitmapFile.close();
 		return false;
 	}
 
+	// Everything up to the start of the bit map data is read into memory once, in order, so that it
+	// can be parsed from a stream and copied into each icon file without going back to the input
+	std::vector<char> bitmapHeaders(54);
+	bitmapStream.read(&bitmapHeaders[0], 54);
+	if(bitmapStream.gcount() != 54) {
+		bitmapInfo.printMessage(ConsoleOutput::ERR,	"Bitmap file is too small to contain minimum required file headers. File is", bitmapStream.gcount(), "bytes");
+		bitmapFile.close();
+		return false;
+	}
+
 	//--------------------------------------------------
 	// Processing bitmap file header
 	//--------------------------------------------------
 	// Extract useful information from the 14 byte Bitmap file Header
 	// Position:00-01, Length:2, Info: File identifier bytes "BM" / 0x424D
 	uint16_t bmpFileId = 0;
-	bitmapFile.seekg(0);
-	bitmapFile.read((char *)&bmpFileId, sizeof(uint16_t));
+	memcpy(&bmpFileId, &bitmapHeaders[0], sizeof(uint16_t));
 	// Position:02-05, Length:4, Info: File size in bytes, little endian format
 	uint32_t bmpFileSize = 0;
-	bitmapFile.seekg(2);
-	bitmapFile.read((char *)&bmpFileSize, sizeof(uint32_t));
+	memcpy(&bmpFileSize, &bitmapHeaders[2], sizeof(uint32_t));
 	// Position:10-13, Length:4, Info: Offset in file where bit map data begins, little endian format
 	uint32_t bmpDataOffset = 0;
-	bitmapFile.seekg(10);
-	bitmapFile.read((char *)&bmpDataOffset, sizeof(uint32_t));
+	memcpy(&bmpDataOffset, &bitmapHeaders[10], sizeof(uint32_t));
 
 	// Sanity check parameters from Bitmap file header
 	// Check file is in windows bitmap format. The first 2 bytes should be the ascii characters B and M (Bytes 0-1 = 0x42, 0x4D)
@@ -262,7 +1043,13 @@ int main(int argc, char * argv[]) {
 	}
 
 	// Print the filesize in bytes. Check for agreement between size recorded within the file and file.size() method
-	if(bitmapFileSize == bmpFileSize) {
+	if(streamedInput) {
+		bitmapFileSize = bmpFileSize;
+		if(verbose) {
+			bitmapInfo.printMessage(ConsoleOutput::INFO, "Size of the file is declared within the file to be",	bmpFileSize, "bytes");
+		}
+	}
+	else if(bitmapFileSize == bmpFileSize) {
 		if(verbose) {
 			bitmapInfo.printMessage(ConsoleOutput::INFO, "Size returned by File.size() agrees with size declared within file", inputFile);
 			bitmapInfo.printMessage(ConsoleOutput::INFO, "Size of the file is",	bmpFileSize, "bytes");
@@ -288,55 +1075,61 @@ int main(int argc, char * argv[]) {
 		bitmapInfo.printMessage(ConsoleOutput::ERR, "File size is",	bitmapFileSize, "bytes");
 		return false;
 	}
+	// A stream has no real size to check the offset against, only the one declared within it. The headers
+	// are read into memory before the bit map data, so the offset is held to the longest headers a file can need
+	if(streamedInput && bmpDataOffset > BmpHeader::maxSize) {
+		bitmapInfo.printMessage(ConsoleOutput::ERR, "The offset at which the bit map data begins is beyond the longest possible headers of", BmpHeader::maxSize, "bytes");
+		bitmapInfo.printMessage(ConsoleOutput::ERR, "Bit map data offset is", bmpDataOffset, "bytes");
+		return false;
+	}
+	if(bmpDataOffset > 54) {
+		bitmapHeaders.resize(bmpDataOffset);
+		bitmapStream.read(&bitmapHeaders[54], bmpDataOffset - 54);
+		if(bitmapStream.gcount() != bmpDataOffset - 54) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to read all headers from bitmap file. Failed after", 54 + bitmapStream.gcount(), "bytes");
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected to read", bmpDataOffset, "bytes");
+			bitmapFile.close();
+			return false;
+		}
+	}
 
 	//--------------------------------------------------
 	// Processing DIB (bitmap information) header
 	//--------------------------------------------------
 	// Extract useful information from the 124 byte DIB bitmap information header
 	// Position:14-17, Length:4, Info: DIB header length in bytes. 124 bytes for the BITMAPV5HEADER variant
-	bitmapFile.seekg(14);
 	uint32_t dibDibLength = 0;
-	bitmapFile.read((char *)&dibDibLength, sizeof(uint32_t));
+	memcpy(&dibDibLength, &bitmapHeaders[14], sizeof(uint32_t));
 	// Position:18-21, Length:4, Info: Image width in pixels
-	bitmapFile.seekg(18);
 	uint32_t dibImageWidth = 0;
-	bitmapFile.read((char *)&dibImageWidth, sizeof(uint32_t));
+	memcpy(&dibImageWidth, &bitmapHeaders[18], sizeof(uint32_t));
 	// Position 22-25, Length:4, Info: Image height in pixels
-	bitmapFile.seekg(22);
 	uint32_t dibImageHeight = 0;
-	bitmapFile.read((char *)&dibImageHeight, sizeof(uint32_t));
+	memcpy(&dibImageHeight, &bitmapHeaders[22], sizeof(uint32_t));
 	// Position 26-27, Length:2, Info: Number of colour planes in image. MUST BE 1
-	bitmapFile.seekg(26);
 	uint16_t dibColourPlanes = 0;
-	bitmapFile.read((char *)&dibColourPlanes, sizeof(uint16_t));
+	memcpy(&dibColourPlanes, &bitmapHeaders[26], sizeof(uint16_t));
 	// Position 28-29, Length:2, Info: Number of bits per pixel/home/richard/Documents/
-	bitmapFile.seekg(28);
 	uint16_t dibBitsPerPixel = 0;
-	bitmapFile.read((char *)&dibBitsPerPixel, sizeof(uint16_t));
+	memcpy(&dibBitsPerPixel, &bitmapHeaders[28], sizeof(uint16_t));
 	// Position 30-33, Length:4, Info: Compression method NEED 1 (no compression) here
-	bitmapFile.seekg(30);
 	uint32_t dibCompression = 0;
-	bitmapFile.read((char *)&dibCompression, sizeof(uint32_t));
+	memcpy(&dibCompression, &bitmapHeaders[30], sizeof(uint32_t));
 	// Position 34-37, Length:4, Info: length of bit map data within the bitmap file
-	bitmapFile.seekg(34);
 	uint32_t dibLengthOfBitMapData = 0;
-	bitmapFile.read((char *)&dibLengthOfBitMapData, sizeof(uint32_t));
+	memcpy(&dibLengthOfBitMapData, &bitmapHeaders[34], sizeof(uint32_t));
 	// Position 38-41, Length:4, Info: horizontal resolution, pixels per metre, irrelevant here
-	bitmapFile.seekg(38);
 	uint32_t dibHorizontalResolution = 0;
-	bitmapFile.read((char *)&dibHorizontalResolution, sizeof(uint32_t));
+	memcpy(&dibHorizontalResolution, &bitmapHeaders[38], sizeof(uint32_t));
 	// Position 42-45, Length:4, Info: vertical resolution, pixels per metre, irrelevant here
-	bitmapFile.seekg(42);
 	uint32_t dibVerticalResolution = 0;
-	bitmapFile.read((char *)&dibVerticalResolution, sizeof(uint32_t));
+	memcpy(&dibVerticalResolution, &bitmapHeaders[42], sizeof(uint32_t));
 	// Position 46-49, Length:4, Info: number of colours in colour palette MUST BE 2
-	bitmapFile.seekg(46);
 	uint32_t dibColoursInPalette = 0;
-	bitmapFile.read((char *)&dibColoursInPalette, sizeof(uint32_t));
+	memcpy(&dibColoursInPalette, &bitmapHeaders[46], sizeof(uint32_t));
 	// Position 50-53, Length:4, Info: number of important colours. Not terribly important for 1 bit-per-pixel bitmaps!
-	bitmapFile.seekg(50);
 	uint32_t dibImportantColours = 0;
-	bitmapFile.read((char *)&dibImportantColours, sizeof(uint32_t));
+	memcpy(&dibImportantColours, &bitmapHeaders[50], sizeof(uint32_t));
 
 	// Print and sanity check the DIB header information
 	if(verbose) {
@@ -457,18 +1250,11 @@ int main(int argc, char * argv[]) {
 	// Padding bits and bytes at the endo of each line appear to be stored as zeroes
 	bool invertBitMap = false;
 	uint32_t * colourTable = new uint32_t[numColoursInColourTable];
-	bitmapFile.seekg(colourTableOffset);
 	for (unsigned int i = 0; i < numColoursInColourTable; i++) {
-		bitmapFile.read((char *)(colourTable + i), sizeof(uint32_t));
-		if(!bitmapFile) {
-			bitmapInfo.printMessage(ConsoleOutput::ERR,	"Unable to read sufficient bytes from file to populate colour table", "");
-			bitmapFile.close();
-			return false;
-		}
-		else {
-			// remove alpha chanel byte which is not needed (set to zero in this case)
-			// colourTable[i] &= ~(0xFF << 24);
-		}
+		// The colour table ends at bmpDataOffset, so it has already been read in with the headers
+		memcpy(colourTable + i, &bitmapHeaders[colourTableOffset + (i * sizeof(uint32_t))], sizeof(uint32_t));
+		// remove alpha chanel byte which is not needed (set to zero in this case)
+		// colourTable[i] &= ~(0xFF << 24);
 	}
 
 	// Monochrome colours might not be black and white, so just take lowest value hex colour value as black
@@ -509,29 +1295,69 @@ int main(int argc, char * argv[]) {
 		bitmapInfo.printMessage(ConsoleOutput::INFO, "Number of bytes required to store one row of bit map data with 4-byte-multiple padding is", bytesInBitMapRow, "bytes");
 	}
 
-	const uint32_t numBytesInBitmap = ceil((double)dibImageHeight * bytesInImageRow);
-	uint8_t * bitmapData = new uint8_t[numBytesInBitmap];
-
-	for(unsigned int currentLine = 0; currentLine < dibImageHeight; currentLine++) {
-		bitmapFile.seekg(bmpDataOffset + (bytesInBitMapRow*dibImageHeight) - ((currentLine+1)*bytesInBitMapRow));
-		bitmapFile.read((char *)bitmapData+(currentLine*bytesInImageRow), bytesInImageRow);
-		if(bitmapFile.gcount() != bytesInImageRow) {
-			bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to read sufficent bytes from bit map to fill a row in the framebuffer", "");
-			bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed on image line", currentLine);
+	//--------------------------------------------------
+	// Decide how much of the bit map to hold in memory
+	//--------------------------------------------------
+	// Without a memory limit the whole bit map is read once and held in memory.
+	// If a limit has been set that the whole bit map will not fit within, the bit map is instead
+	// held in bands of rows and each of the passes below makes its own trip through the file.
+	// The mmap reader maps the whole file, whose pages count towards the resident set as they are copied
+	// out, so it cannot be kept within a memory limit
+	if(memoryBudget.isLimited() && readMethod == SheetBuffer::READ_MMAP && !streamedInput) {
+		bitmapInfo.printMessage(ConsoleOutput::WARN, "The mmap reader maps the whole file, beyond the maximum memory. Using the sequential reader instead for", inputFile);
+		readMethod = SheetBuffer::READ_SEQUENTIAL;
+	}
+	const uint64_t numBytesInBitmap = (uint64_t)dibImageHeight * bytesInImageRow;
+	unsigned int bandRows = dibImageHeight;
+	memoryBudget.settle();
+	if(memoryBudget.isLimited()) {
+		// Leave a quarter of the budget for the icon buffers and the lists of rows, columns and icons.
+		// The chunked readers take their two chunk buffers out of the rest
+		uint64_t bytesForBands = (memoryBudget.bytesForData() / 4) * 3;
+		if(streamedInput || readMethod != SheetBuffer::READ_IFSTREAM) {
+			bytesForBands -= std::min(bytesForBands, 2 * SheetBuffer::chunkBytesFor(bytesForBands));
+		}
+		if(SheetBuffer::rowsWithin(bytesForBands, bytesInImageRow) == 0) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Maximum memory is too small to hold a single row of the bit map. Bytes available are", memoryBudget.bytesForData());
 			bitmapFile.close();
 			return false;
 		}
+		if(SheetBuffer::allocationBytes(numBytesInBitmap) > bytesForBands) {
+			bandRows = SheetBuffer::rowsWithin(bytesForBands, bytesInImageRow);
+		}
+	}
+	if(streamedInput && bandRows < dibImageHeight) {
+		bitmapInfo.printMessage(ConsoleOutput::ERR, "Streamed input can only be read once, so the whole bit map must fit within the maximum memory. Bytes required are", numBytesInBitmap);
+		return false;
+	}
+	SheetBuffer sheet(bitmapStream, bmpDataOffset, dibImageWidth, dibImageHeight, bytesInImageRow, bytesInBitMapRow, invertBitMap, bandRows);
+	if(streamedInput) {
+		if(readMethod != SheetBuffer::READ_IFSTREAM) {
+			bitmapInfo.printMessage(ConsoleOutput::WARN, "Streamed input is read in a single pass. Ignoring the reader", readMethodName);
+		}
+		if(!sheet.setReadMethod(SheetBuffer::READ_STREAM, inputFile)) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to allocate buffers for reading streamed input", "");
+			return false;
+		}
 	}
-	if(invertBitMap) {
-		for(unsigned int i = 0; i<numBytesInBitmap; i++) {
-			bitmapData[i] = ~(bitmapData[i]);
+	else if(!sheet.setReadMethod(readMethod, inputFile)) {
+		// Not every filesystem supports O_DIRECT, in which case fall back to the page cache friendly buffered reader
+		if(readMethod == SheetBuffer::READ_DIRECT && sheet.setReadMethod(SheetBuffer::READ_SEQUENTIAL, inputFile)) {
+			bitmapInfo.printMessage(ConsoleOutput::WARN, "Unable to open the input file for direct I/O. Using the sequential reader instead for", inputFile);
+		}
+		else {
+			bitmapInfo.printMessage(ConsoleOutput::WARN, "Unable to open the input file with the chosen reader. Using the ifstream reader instead for", inputFile);
 		}
 	}
-	// Ensure that all padding bits in bytes at the RHS of the bitmap are ones
-	if(dibImageWidth%8 != 0) {
-		const uint8_t bitMask = ( pow(2,(8- (dibImageWidth%8) ) ) - 1);
-		for(unsigned int row=1; row<dibImageHeight+1; row++) {
-			bitmapData[(row*bytesInImageRow)-1] |= bitMask;
+	if(verbose) {
+		if(sheet.holdsWholeSheet()) {
+			bitmapInfo.printMessage(ConsoleOutput::INFO, "Whole bit map is held in memory, requiring", numBytesInBitmap, "bytes");
+		}
+		else {
+			bitmapInfo.printMessage(ConsoleOutput::INFO, "Bit map is too large for the maximum memory and will be read in bands of", sheet.capacityRows(), "rows");
+		}
+		if(sheet.usesHugePages()) {
+			bitmapInfo.printMessage(ConsoleOutput::INFO, "Bit map buffer is mapped with a transparent huge page hint", "");
 		}
 	}
 
@@ -539,35 +1365,89 @@ int main(int argc, char * argv[]) {
 	// Establish the limits of each icon within the bitmap
 	//--------------------------------------------------
 
+	// Noise is cleaned from the whole bit map before the icons are looked for, so that specks neither show up
+	// as icons of their own nor widen the rows and columns of the icons they lie beside. The cleaned rows stay
+	// in memory for extraction.
+	if(!denoiseOperation.empty()) {
+		if(!sheet.holdsWholeSheet()) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Denoising needs the whole bit map to fit within the maximum memory. Bytes required are", numBytesInBitmap);
+			bitmapFile.close();
+			return false;
+		}
+		if(!sheet.load(0, dibImageHeight)) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to read sufficent bytes from bit map to fill a row in the framebuffer", "");
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed on image line", sheet.failedRow());
+			bitmapFile.close();
+			return false;
+		}
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		uint8_t * sheetData = sheet.row(0);
+		if(denoiseOperation == "specks") {
+			Morphology::despeckle(sheetData, dibImageWidth, dibImageHeight, sheetData);
+		}
+		else if(denoiseOperation == "open") {
+			Morphology::open(sheetData, dibImageWidth, dibImageHeight, sheetData);
+		}
+		else {
+			Morphology::close(sheetData, dibImageWidth, dibImageHeight, sheetData);
+		}
+		if(verbose) {
+			bitmapInfo.printMessage(ConsoleOutput::INFO, "Time spent denoising the bit map was",
+					std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(), "ms");
+		}
+	}
+
 	// in bitmap data, 1 is white, 0 is black
 	// First establish overall bounds of the rows and columns
 	// First element of pair is start of a row/col, second element of pair is end of a row/col
 	std::list <std::pair <unsigned int, unsigned int>> rows;
 	std::list <std::pair <unsigned int, unsigned int>> cols;
+	// A column contains black pixels if its bit is zero in the bitwise AND of every row,
+	// so the columns can be found in the same pass through the bit map as the rows
+	std::vector<uint8_t> columnInk(bytesInImageRow, 0xFF);
 	// Find tops and bottoms of icon rows
 	bool iconRowDetected = false;
-	for(unsigned int row=0; row<dibImageHeight; row++) {
-		bool pixelDetectedInRow = false;
-		for(unsigned int col=0; col<bytesInImageRow; col++) {
-			// detect black pixels
-			if(bitmapData[(row*bytesInImageRow)+col] != 0xFF) {
-				pixelDetectedInRow = true;
-				break;
-			}
-		}
-		// Start of an icon row detected
-		if(!iconRowDetected && pixelDetectedInRow) {
-			iconRowDetected = true;
-			// Set start of row in list of pairs
-			rows.emplace_back();
-			rows.back().first = row;
+	for(unsigned int bandStart = 0; bandStart < dibImageHeight; bandStart += sheet.capacityRows()) {
+		const unsigned int rowsInBand = std::min(sheet.capacityRows(), dibImageHeight - bandStart);
+		if(!sheet.load(bandStart, rowsInBand)) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to read sufficent bytes from bit map to fill a row in the framebuffer", "");
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed on image line", sheet.failedRow());
+			bitmapFile.close();
+			return false;
 		}
-		// end of an icon row detected
-		else if(iconRowDetected && !pixelDetectedInRow) {
-			iconRowDetected = false;
-			rows.back().second = row - 1;
+		for(unsigned int row=bandStart; row<bandStart+rowsInBand; row++) {
+			const uint8_t * rowData = sheet.row(row);
+			bool pixelDetectedInRow = false;
+			for(unsigned int col=0; col<bytesInImageRow; col++) {
+				// detect black pixels
+				if(rowData[col] != 0xFF) {
+					pixelDetectedInRow = true;
+				}
+				columnInk[col] &= rowData[col];
+			}
+			// Start of an icon row detected
+			if(!iconRowDetected && pixelDetectedInRow) {
+				iconRowDetected = true;
+				// Set start of row in list of pairs
+				rows.emplace_back();
+				rows.back().first = row;
+			}
+			// end of an icon row detected
+			else if(iconRowDetected && !pixelDetectedInRow) {
+				iconRowDetected = false;
+				rows.back().second = row - 1;
+			}
 		}
 	}
+	// icon row running into the bottom edge of the bitmap
+	if(iconRowDetected) {
+		rows.back().second = dibImageHeight - 1;
+	}
+	// Everything needed from a stream has now been read. Check that the decompressor, if any, was happy with its input.
+	if(streamedInput && !inputPipe.finish()) {
+		bitmapInfo.printMessage(ConsoleOutput::ERR, "Decompressor reported an error while reading the input file", inputFile);
+		return false;
+	}
 	if(rows.size() == 0) {
 		bitmapInfo.printMessage(ConsoleOutput::ERR, "No icon rows found in bitmap image", "");
 		bitmapFile.close();
@@ -577,17 +1457,10 @@ int main(int argc, char * argv[]) {
 	// Find lefts and rights of icon columns
 	bool iconColDetected = false;
 	for(unsigned int col=0; col<dibImageWidth; col++) {
-		bool pixelDetectedInCol = false;
-		for(unsigned int row=0; row<dibImageHeight; row++) {
-			// isolate and invert byte from bitmapData array
-			const unsigned int byteInCurrentRow = floor((double)col/8);
-			const uint8_t bitmask = (1 << (7-(col%8)));
-			const uint8_t currentByte = ~(bitmapData[(row*bytesInImageRow)+byteInCurrentRow]);
-			if(bitmask & currentByte) {
-				pixelDetectedInCol = true;
-				break;
-			}
-		}
+		// isolate and invert bit from the accumulated columns
+		const uint8_t bitmask = (1 << (7-(col%8)));
+		const uint8_t currentByte = ~(columnInk[col/8]);
+		const bool pixelDetectedInCol = (bitmask & currentByte) != 0;
 		// start of icon column detected
 		if(!iconColDetected && pixelDetectedInCol) {
 			iconColDetected = true;
@@ -600,6 +1473,10 @@ int main(int argc, char * argv[]) {
 			cols.back().second = col - 1;
 		}
 	}
+	// icon column running into the right hand edge of the bitmap
+	if(iconColDetected) {
+		cols.back().second = dibImageWidth - 1;
+	}
 
 	if(verbose) {
 		bitmapInfo.printMessage(ConsoleOutput::INFO, "There are", rows.size(), "rows of icons detected in the bitmap");
@@ -616,104 +1493,87 @@ int main(int argc, char * argv[]) {
 	// to smaller icons as they are extracted to their indivudual bitmap files.
 
 	// Discover the extents of each individual icon
-	struct iconExtents {
-		unsigned int top;
-		unsigned int bottom;
-		unsigned int left;
-		unsigned int right;
-	};
 	std::list<iconExtents> iconList;
+	// The extents of all icons in a row are gathered in a single top to bottom pass over that row,
+	// so that a row of icons taller than the band of rows held in memory is still only read once
+	std::vector<iconExtents> iconsInRow(cols.size());
+	std::vector<bool> pixelFoundInCell(cols.size());
+	// Streamed and denoised bit maps cannot be read again, so must stay whole
+	const bool stayingWhole = streamedInput || !denoiseOperation.empty();
+	const unsigned int bandRowsForRows = sheet.capacityRows();
 	for(std::list<std::pair<unsigned int, unsigned int>>::iterator itRow = rows.begin(); itRow!=rows.end(); itRow++) {
-		for(std::list<std::pair<unsigned int, unsigned int>>::iterator itCol = cols.begin(); itCol!=cols.end(); itCol++) {
-		iconList.emplace_back();
-			// find extents of current icon
-			bool foundPixel = false;
-			// find top extent of icon
-			for(unsigned int row = itRow->first; row < (itRow->second + 1); row++) {
-				for(unsigned int col = itCol->first; col < (itCol->second + 1); col++) {
-					// check relevant pixel with a bitmask and bitwise AND operation
-					const unsigned int byteInCurrentRow = floor((double)col/8);
-					const uint8_t bitmask = (1 << (7-(col%8)));
-					const uint8_t currentByte = ~(bitmapData[(row*bytesInImageRow)+byteInCurrentRow]);
-					if(bitmask & currentByte) {
-						iconList.back().top = row;
-						foundPixel = true;
-						break;
+		// Under a memory limit the band is narrowed to make room for the extents of every icon that this row of icons could add
+		const uint64_t bytesForExtents = sheet.readerBytes() + ((uint64_t)(iconList.size() + cols.size()) * iconListNodeBytes);
+		if(!fitBand(sheet, memoryBudget, bytesForExtents, 1, stayingWhole, bytesInImageRow)) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Maximum memory is too small to hold the extents of every icon. Bytes available are", memoryBudget.bytesForData());
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Bytes required are", bytesForExtents + (stayingWhole ? sheet.sizeInBytes() : bytesInImageRow));
+			bitmapFile.close();
+			return false;
+		}
+		unsigned int cell = 0;
+		for(std::list<std::pair<unsigned int, unsigned int>>::iterator itCol = cols.begin(); itCol!=cols.end(); itCol++, cell++) {
+			iconsInRow[cell].cellTop = itRow->first;
+			iconsInRow[cell].cellBottom = itRow->second;
+			iconsInRow[cell].cellLeft = itCol->first;
+			iconsInRow[cell].cellRight = itCol->second;
+			pixelFoundInCell[cell] = false;
+		}
+		for(unsigned int bandStart = itRow->first; bandStart <= itRow->second; bandStart += sheet.capacityRows()) {
+			const unsigned int rowsInBand = std::min(sheet.capacityRows(), (itRow->second + 1) - bandStart);
+			if(!sheet.load(bandStart, rowsInBand)) {
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to read sufficent bytes from bit map to fill a row in the framebuffer", "");
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed on image line", sheet.failedRow());
+				bitmapFile.close();
+				return false;
+			}
+			for(unsigned int row = bandStart; row < bandStart + rowsInBand; row++) {
+				const uint8_t * rowData = sheet.row(row);
+				cell = 0;
+				for(std::list<std::pair<unsigned int, unsigned int>>::iterator itCol = cols.begin(); itCol!=cols.end(); itCol++, cell++) {
+					unsigned int leftInk = 0;
+					unsigned int rightInk = 0;
+					if(findInkInRow(rowData, itCol->first, itCol->second, leftInk, rightInk)) {
+						iconExtents & icon = iconsInRow[cell];
+						if(!pixelFoundInCell[cell]) {
+							pixelFoundInCell[cell] = true;
+							icon.top = row;
+							icon.left = leftInk;
+							icon.right = rightInk;
+						}
+						icon.bottom = row;
+						icon.left = (leftInk < icon.left) ? leftInk : icon.left;
+						icon.right = (rightInk > icon.right) ? rightInk : icon.right;
 					}
 				}
-				if(foundPixel) {
-					break;
-				}
 			}
-			// Quick sanity check before proceeding further (only need to do this check once)
+		}
+		cell = 0;
+		for(std::list<std::pair<unsigned int, unsigned int>>::iterator itCol = cols.begin(); itCol!=cols.end(); itCol++, cell++) {
 			// Check if any pixels found at this particular row/col grid. If not then it is an incomplete
 			// row/col with no icon present at this particular grid.
-			// Delete the list element created earlier to hold the now non-existent icon and break to the next iteration of row
-			if(!foundPixel) {
+			if(!pixelFoundInCell[cell]) {
 				bitmapInfo.printMessage(ConsoleOutput::WARN, "Unable to find any pixels within the following row/column bounds", "");
 				bitmapInfo.printMessage(ConsoleOutput::WARN, "Top bound is", itRow->first);
 				bitmapInfo.printMessage(ConsoleOutput::WARN, "Bottom bound is", itRow->second);
 				bitmapInfo.printMessage(ConsoleOutput::WARN, "Left bound is", itCol->first);
 				bitmapInfo.printMessage(ConsoleOutput::WARN, "Right bound is", itCol->second);
-				iconList.pop_back();
 			}
 			else {
-				// find bottom extent of icon
-				foundPixel = false;
-				for(unsigned int row = itRow->second; row > (itRow->first - 1); row--) {
-					for(unsigned int col = itCol->first; col < (itCol->second + 1); col++) {
-						// check relevant pixel with a bitmask and bitwise AND operation
-						const unsigned int byteInCurrentRow = floor((double)col/8);
-						const uint8_t bitmask = (1 << (7-(col%8)));
-						const uint8_t currentByte = ~(bitmapData[(row*bytesInImageRow)+byteInCurrentRow]);
-						if(bitmask & currentByte) {
-							iconList.back().bottom = row;
-							foundPixel = true;
-							break;
-						}
-					}
-					if(foundPixel) {
-						break;
-					}
-				}
-				// find left extent of icon
-				foundPixel = false;
-				for(unsigned int col = itCol->first; col < (itCol->second + 1); col++) {
-					const unsigned int byteInCurrentCol = floor((double)col/8);
-					const uint8_t bitmask = (1 << (7-(col%8)));
-					for(unsigned int row = itRow->first; row < (itRow->second + 1); row++) {
-						const uint8_t currentByte = ~(bitmapData[(row*bytesInImageRow)+byteInCurrentCol]);
-						if(bitmask & currentByte) {
-							iconList.back().left = col;
-							foundPixel = true;
-							break;
-						}
-					}
-					if(foundPixel) {
-						break;
-					}
-				}
-				// find right extent of icon
-				foundPixel = false;
-				for(unsigned int col = itCol->second; col > (itCol->first - 1); col--) {
-					const unsigned int byteInCurrentCol = floor((double)col/8);
-					const uint8_t bitmask = (1 << (7-(col%8)));
-					for(unsigned int row = itRow->first; row < (itRow->second + 1); row++) {
-						const uint8_t currentByte = ~(bitmapData[(row*bytesInImageRow)+byteInCurrentCol]);
-						if(bitmask & currentByte) {
-							iconList.back().right = col;
-							foundPixel = true;
-							break;
-						}
-					}
-					if(foundPixel) {
-						break;
-					}
-				}
+				iconList.push_back(iconsInRow[cell]);
 			}
 		}
 	}
-
+	// The band is narrowed again before the dimensions and placements of every icon and its variants are laid out
+	const uint64_t bytesForEntries = sheet.readerBytes() + bytesForIconEntries(iconList.size(), scaleFactors.size() * (boldVariants ? 2 : 1));
+	if(!fitBand(sheet, memoryBudget, bytesForEntries, 1, stayingWhole, bytesInImageRow)) {
+		bitmapInfo.printMessage(ConsoleOutput::ERR, "Maximum memory is too small to hold the dimensions of every icon. Bytes available are", memoryBudget.bytesForData());
+		bitmapInfo.printMessage(ConsoleOutput::ERR, "Bytes required are", bytesForEntries + (stayingWhole ? sheet.sizeInBytes() : bytesInImageRow));
+		bitmapFile.close();
+		return false;
+	}
+	if(verbose && sheet.capacityRows() != bandRowsForRows) {
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Bit map will be read in bands of", sheet.capacityRows(), "rows once the extents of the icons are found");
+	}
 	// TODO: Delete as not really necessary? Plus it clogs up the verbose output for individual icon information with info about the overall bitmap
 	// sanity check - have we stored the extents of all icons discovered in the earlier, cruder search for rows and columns?
 //	if(iconList.size() != (rows.size()*cols.size())) {
@@ -750,284 +1610,463 @@ int main(int argc, char * argv[]) {
 //	}
 
 	//--------------------------------------------------
-	// Create new bitmap files for each individual icon
+	// Write each icon to every output
 	//--------------------------------------------------
-	unsigned int iconNumber = 0;
-	for(std::list<iconExtents>::iterator it = iconList.begin(); it != iconList.end(); it++, iconNumber++) {
-		if(verbose) {
-			cout << endl;
-			bitmapInfo.printHeading("Icon information");
-		}
-		// Create numbered flenames with enough leading zeroes so that the lowest numbers are the same length as the highest
-		// TODO prepend file path onto filename
-		std::string fileNumber = std::to_string(iconNumber);
-		fileNumber.insert(0,(std::to_string(iconList.size()).size() - fileNumber.size()),'0');
-		fileNumber.append(".bmp"); // TODO: prefix a proper full path onto the filename
-		std::ofstream iconFile;
-		iconFile.open(fileNumber.insert(0,outputDir), (std::ofstream::out | std::ofstream::binary | std::ios::trunc));
-		if(iconFile.fail()) {
-			cerr << "ERROR\t\tFailed to create icon file " << fileNumber << endl;
-			cout << endl;
-			return false;
-		}
-		else {
-			if(verbose) {
-				bitmapInfo.printMessage(ConsoleOutput::INFO, "Icon bitmap file", fileNumber, "created for writing");
-			}
-		}
+	// Trimmed icons are stored without margins or padding. The margins still count towards the uniform cell
+	// that --samesize pads every icon out to, which the metadata positions icons within
+	const bool storedSameSize = sameSizeIcons && !trimIcons;
+	const unsigned int storedHorizontalMargin = trimIcons ? 0 : horizontalMargin;
+	const unsigned int storedVerticalMargin = trimIcons ? 0 : verticalMargin;
+	const uint32_t cellWidth = maxIconWidth + (2*horizontalMargin);
+	const uint32_t cellHeight = maxIconHeight + (2*verticalMargin);
 
-		uint32_t iconWidth = 0;
-		uint32_t iconHeight = 0;
-		if(sameSizeIcons) {
-			//  maxIconWIdth has already been +1'ed above
-			iconWidth = maxIconWidth + (2*horizontalMargin);
-			iconHeight = maxIconHeight + (2*verticalMargin);
-		}
-		else {
-			// +1 for actual pixel width e.g. an icon from px2 to px6 is 5 pixels wide
-			// 0 1 2 3 4 5 6 7 8 9
-			// - - X X X X X - - -
-			iconWidth = (it->right - it->left) + 1 + (2*horizontalMargin);
-			iconHeight = (it->bottom - it->top) + 1 + (2*verticalMargin);
+	// The dimensions of every icon are known from its extents, so outputs such as the atlas
+	// can be laid out before any icon is extracted
+	std::vector<iconExtents> icons(iconList.begin(), iconList.end());
+	std::vector<uint32_t> iconWidths(icons.size());
+	std::vector<uint32_t> iconHeights(icons.size());
+	std::vector<iconPlacement> iconPlacements(icons.size());
+	uint64_t largestIconArraySize = 0;
+	for(unsigned int i = 0; i < icons.size(); i++) {
+		iconDimensions(icons[i], storedSameSize, maxIconWidth, maxIconHeight, storedHorizontalMargin, storedVerticalMargin, iconWidths[i], iconHeights[i]);
+		largestIconArraySize = std::max(largestIconArraySize, AtlasSink::bytesForIcon(iconWidths[i], iconHeights[i]));
+		// The ink sits at the same place in the uniform cell as --samesize would put it. The stored image
+		// starts as far before that as its own margins and padding reach
+		unsigned int inkInCellLeft = 0;
+		unsigned int inkInCellTop = 0;
+		unsigned int inkInImageLeft = 0;
+		unsigned int inkInImageTop = 0;
+		inkOffsets(icons[i], cellWidth, cellHeight, horizontalMargin, verticalMargin, inkInCellLeft, inkInCellTop);
+		inkOffsets(icons[i], iconWidths[i], iconHeights[i], storedHorizontalMargin, storedVerticalMargin, inkInImageLeft, inkInImageTop);
+		iconPlacements[i].cellX = (int32_t)inkInCellLeft - (int32_t)inkInImageLeft;
+		iconPlacements[i].cellY = (int32_t)inkInCellTop - (int32_t)inkInImageTop;
+		iconPlacements[i].gridX = (int32_t)(icons[i].left - icons[i].cellLeft) - (int32_t)inkInImageLeft;
+		iconPlacements[i].gridY = (int32_t)(icons[i].top - icons[i].cellTop) - (int32_t)inkInImageTop;
+	}
+
+	// Icons are extracted the way up they are on the sheet, then turned and mirrored. The outputs see the
+	// turned dimensions, with the placements turned and mirrored along with the cells they are placed in
+	const unsigned int quarterTurns = rotationDegrees / 90;
+	const std::vector<uint32_t> sheetIconWidths(iconWidths);
+	const std::vector<uint32_t> sheetIconHeights(iconHeights);
+	const uint32_t turnedCellWidth = (quarterTurns % 2 == 1) ? cellHeight : cellWidth;
+	const uint32_t turnedCellHeight = (quarterTurns % 2 == 1) ? cellWidth : cellHeight;
+	for(unsigned int i = 0; i < icons.size() && (quarterTurns != 0 || mirrorIcons); i++) {
+		const uint32_t gridWidth = (icons[i].cellRight - icons[i].cellLeft) + 1;
+		const uint32_t gridHeight = (icons[i].cellBottom - icons[i].cellTop) + 1;
+		turnPlacement(iconPlacements[i].cellX, iconPlacements[i].cellY, iconWidths[i], iconHeights[i], cellWidth, cellHeight, quarterTurns);
+		turnPlacement(iconPlacements[i].gridX, iconPlacements[i].gridY, iconWidths[i], iconHeights[i], gridWidth, gridHeight, quarterTurns);
+		if(quarterTurns % 2 == 1) {
+			std::swap(iconWidths[i], iconHeights[i]);
+			largestIconArraySize = std::max(largestIconArraySize, AtlasSink::bytesForIcon(iconWidths[i], iconHeights[i]));
 		}
-		const unsigned int iconArraySize = ceil((double)iconWidth/8) * iconHeight;
-		uint8_t * iconData = new uint8_t[iconArraySize];
-		// as the iconData array will be largely filled by bitwise OR operations it is important to initialise it to zeroes
-		for(unsigned int i=0; i<iconArraySize; i++) {
-			iconData[i] = 0x00;
+		if(mirrorIcons) {
+			iconPlacements[i].cellX = (int32_t)turnedCellWidth - iconPlacements[i].cellX - (int32_t)iconWidths[i];
+			iconPlacements[i].gridX = (int32_t)((quarterTurns % 2 == 1) ? gridHeight : gridWidth) - iconPlacements[i].gridX - (int32_t)iconWidths[i];
 		}
+	}
 
-		if(verbose) {
-			bitmapInfo.printMessage(ConsoleOutput::INFO, "Horizontal margin of", horizontalMargin, "pixels added to this icon");
-			bitmapInfo.printMessage(ConsoleOutput::INFO, "Vertical margin of", verticalMargin, "pixels added to this icon");
-			bitmapInfo.printMessage(ConsoleOutput::INFO, "Icon pixel width including margin is", iconWidth);
-			bitmapInfo.printMessage(ConsoleOutput::INFO, "Icon pixel height including margin is", iconHeight);
-			bitmapInfo.printMessage(ConsoleOutput::INFO, "Size of array required to hold this icon is", iconArraySize);
-		}
-
-		// Add margins to all sides and any additional white padding required if current icon dimensions != max icon dimensions
-		unsigned int whitePixelsAtTop    = verticalMargin   + ceil((double)  ( iconHeight - (2*verticalMargin)  - ((it->bottom - it->top) + 1) ) /2 );
-		unsigned int whitePixelsAtBottom = verticalMargin   + floor((double) ( iconHeight - (2*verticalMargin)  - ((it->bottom - it->top) + 1) ) /2 );
-		unsigned int whitePixelsAtLeft   = horizontalMargin + ceil((double)  ( iconWidth - (2*horizontalMargin) - ((it->right - it->left) + 1) ) /2 );
-		unsigned int whitePixelsAtRight  = horizontalMargin + floor((double) ( iconWidth - (2*horizontalMargin) - ((it->right - it->left) + 1) ) /2 ); // TODO: make sure the padding bits at the end of each line are also 1'ed
-		// add top margin
-		for(unsigned int i=0; i<whitePixelsAtTop*ceil((double)iconWidth/8); i++) {
-			iconData[i] |= 0xFF;
-		}
-
-		// add bottom margin
-		for(unsigned int i = (whitePixelsAtTop + ((it->bottom - it->top) + 1)) * ceil((double)iconWidth/8); i<iconArraySize; i++) {
-			iconData[i] |= 0xFF;
-		}
-
-		// add left margin
-		for(unsigned int row=whitePixelsAtTop; row<iconHeight-whitePixelsAtBottom; row++) {
-			unsigned int col = 0;
-			unsigned int currentByte = row * ceil((double)iconWidth/8);
-			while(col<whitePixelsAtLeft) {
-				// Assumes always starting at MSB of icon byte
-				if(whitePixelsAtLeft-col > 7) {
-					iconData[currentByte++] |= 0xFF;
-					col += 8;
-				}
-				else {
-					uint8_t bitmask = ((uint8_t)pow(2,whitePixelsAtLeft-col)-1) << (8-(whitePixelsAtLeft-col));
-					iconData[currentByte++] |= bitmask;
-					col += whitePixelsAtLeft-col;
-				}
+	// Each icon is then written as every variant: at every scale and, with --bold, emboldened at every scale.
+	// Variant v of icon i is output icon (i * numVariants) + v, and is named with suffixes such as @bold and @2x.
+	// Emboldened icons are grown by a pixel on every side before scaling. Placements are in the variant's own pixels.
+	const unsigned int numScales = scaleFactors.size();
+	const unsigned int numVariants = numScales * (boldVariants ? 2 : 1);
+	const std::vector<uint32_t> orientedIconWidths(iconWidths);
+	const std::vector<uint32_t> orientedIconHeights(iconHeights);
+	std::vector<std::string> variantSuffixes(numVariants);
+	if(numVariants > 1 || scaleFactors[0] != 1) {
+		const std::vector<iconPlacement> orientedPlacements(iconPlacements);
+		iconWidths.resize(icons.size() * numVariants);
+		iconHeights.resize(icons.size() * numVariants);
+		iconPlacements.resize(icons.size() * numVariants);
+		for(unsigned int variant = 0; variant < numVariants; variant++) {
+			const unsigned int factor = scaleFactors[variant % numScales];
+			variantSuffixes[variant] = ((variant >= numScales) ? "@bold" : "") + ((factor == 1) ? std::string("") : ("@" + std::to_string(factor) + "x"));
+		}
+		for(unsigned int i = 0; i < icons.size(); i++) {
+			for(unsigned int variant = 0; variant < numVariants; variant++) {
+				const unsigned int outputIcon = (i * numVariants) + variant;
+				const int32_t factor = scaleFactors[variant % numScales];
+				const int32_t growth = (variant >= numScales) ? 1 : 0;
+				iconWidths[outputIcon] = (orientedIconWidths[i] + (2 * growth)) * factor;
+				iconHeights[outputIcon] = (orientedIconHeights[i] + (2 * growth)) * factor;
+				iconPlacements[outputIcon].cellX = (orientedPlacements[i].cellX - growth) * factor;
+				iconPlacements[outputIcon].cellY = (orientedPlacements[i].cellY - growth) * factor;
+				iconPlacements[outputIcon].gridX = (orientedPlacements[i].gridX - growth) * factor;
+				iconPlacements[outputIcon].gridY = (orientedPlacements[i].gridY - growth) * factor;
+				largestIconArraySize = std::max(largestIconArraySize, AtlasSink::bytesForIcon(iconWidths[outputIcon], iconHeights[outputIcon]));
 			}
 		}
+	}
 
-		// add right margin
-		// this is trickier as it may neither start nor end at the start or end of a byte
-		for(unsigned int row=whitePixelsAtTop; row<iconHeight-whitePixelsAtBottom; row++) {
-			unsigned int col = iconWidth - whitePixelsAtRight;
-			unsigned int currentByte = (row * ceil((double)iconWidth/8)) + floor((double)col/8);
-			unsigned int endOfLineBit = ceil((double)iconWidth/8)*8; // ensures that padding bits at the end of each line are set to 1
-			while(col<endOfLineBit) {
-				uint8_t bitmask = pow(2,8-(col%8))-1;
-				iconData[currentByte++] |= bitmask;
-				col += 8-(col%8);
-			}
-		}
-
-		// The magic happens here:
-		// Copy and bitshift all pixels from the defined "icon" regions in the original bitmap to the new individual icon files
-		for(unsigned int iconRow = whitePixelsAtTop; iconRow < iconHeight-whitePixelsAtBottom; iconRow++) {
-			unsigned int iconCol = whitePixelsAtLeft;
-			unsigned int bitmapRow = it->top + (iconRow - whitePixelsAtTop);
-			unsigned int bitmapCol = it->left;
-			unsigned int currentIconByte = (iconRow * ceil((double)iconWidth/8)) + floor((double)iconCol/8);
-			unsigned int currentBitmapByte = (bitmapRow * ceil((double)dibImageWidth/8)) + floor((double)bitmapCol/8);
-			while(iconCol < iconWidth-whitePixelsAtRight) {
-				uint8_t bitInBitmapByte = (bitmapCol%8);	// 0->7, msb->lsb
-				uint8_t bitInIconByte = (iconCol%8); 		// 0->7, msb->lsb
-				// number of bits to copy must be lt or eq to bits remaining in current icon byte
-				// number of bits to copy must be lt or eq to bits remaining in current bitmap byte
-				// number of bits to copy must be lt or eq to bits remaining on current line
-				uint8_t numBitsToCopy = 0;
-				unsigned int numBitsLeftOnRow = ((iconWidth-whitePixelsAtRight)-iconCol);
-				uint8_t bitsLeftInIconByte = 8-bitInIconByte;	// Max number of bits possible to copy from bitmapData to iconData in next operation
-				uint8_t bitsLeftInBitmapByte = 8-bitInBitmapByte; // Number of bits left to copy from current bitmap byte
-				numBitsToCopy = (bitsLeftInIconByte > bitsLeftInBitmapByte) ? bitsLeftInBitmapByte : bitsLeftInIconByte;
-				numBitsToCopy = (numBitsToCopy < numBitsLeftOnRow ) ? numBitsToCopy : numBitsLeftOnRow;
-				// Construct a bitmask containing the bits to copy from bitmapData to iconData
-				uint8_t bitmask = 0x00;
-				uint8_t bitsToCopy = bitmapData[currentBitmapByte];
-				// e.g. need to write bits     --XXX--- to icon data (making this example work, with 4 remaining but 3 to copy, should ensure end of line compatibility)
-				// from a bitmapByte with bits ----XXXX remaining
-				// Zero any already-copied bits in the bitsToCopy byte
-				bitmask = pow(2,bitsLeftInBitmapByte)-1; // WAS: bitmask = pow(2,bitInBitmapByte)-1; // WAS: bitmask = pow(2,bitInBitmapByte+1)-1;
-				bitsToCopy &= bitmask;
-				if(numBitsToCopy < bitsLeftInBitmapByte) {
-						bitmask = pow(2,bitsLeftInBitmapByte-numBitsToCopy)-1;
-						bitsToCopy ^= bitmask;
+	// Unless given, the ink and background are the colours the input file draws them in, opaque.
+	// Colour table entries are 0x00RRGGBB
+	if(!foregroundColourSpecified) {
+		foregroundColour = ((invertBitMap ? colourTable[1] : colourTable[0]) << 8) | 0xFF;
+	}
+	if(!backgroundColourSpecified) {
+		backgroundColour = ((invertBitMap ? colourTable[0] : colourTable[1]) << 8) | 0xFF;
+	}
+
+	std::vector<IconSink *> iconOutputs;
+	AtlasSink * atlasOutput = NULL;
+	PackedAtlasSink * packedOutput = NULL;
+	RleSink * rleOutput = NULL;
+	RowDictionarySink * rowDictionaryOutput = NULL;
+	AnimationSink * animationOutput = NULL;
+	NearDuplicateSink * nearDuplicateOutput = NULL;
+	DistanceFieldSink * distanceFieldOutput = NULL;
+	for(unsigned int output = 0; output < outputs.size(); output++) {
+		const std::string & format = outputs[output].first;
+		const std::string & target = outputs[output].second;
+		if(format == "bmp" || format == "tar") {
+			// Icon files are written individually into the output directory, or one after another into an archive
+			FileSink * fileOutput = NULL;
+			if(format == "tar") {
+				TarSink * tarOutput = new TarSink(target);
+				if(!tarOutput->isOpen()) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed to create output archive", target);
+					delete tarOutput;
+					deleteIconOutputs(iconOutputs);
+					return false;
 				}
-				// Shift the bitsToCopy left OR right depending on where the iconCol is relative to the bitmapCol
-				// NB: left shift by a negative number is undefined behaviour in C++
-				if(bitInIconByte < bitInBitmapByte) {
-					bitsToCopy = bitsToCopy << (bitInBitmapByte - bitInIconByte);
+				fileOutput = tarOutput;
+			}
+			else {
+				DirectorySink * directoryOutput = new DirectorySink(target, atomicOutput);
+				if(directoryOutput->holdsOtherFiles()) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Atomic publication replaces the whole output directory, so it must be empty or an earlier atomic output. Directory is", target);
+					delete directoryOutput;
+					deleteIconOutputs(iconOutputs);
+					return false;
 				}
-				else {
-					bitsToCopy = bitsToCopy >> (bitInIconByte - bitInBitmapByte);
+				if(!directoryOutput->isOpen()) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed to open output directory, or to create its staging directory, for", (target.empty() ? "." : target));
+					delete directoryOutput;
+					deleteIconOutputs(iconOutputs);
+					return false;
 				}
-				// Update iconData - at last...
-				iconData[currentIconByte] |= bitsToCopy;
-
-				// Update all counter variables ready for next iteration
-				// Neither the currentIconByte nor the currentBitmapByte necessarily increment after a copy operation
-				if(bitsLeftInIconByte - numBitsToCopy == 0) {
-					currentIconByte++;
+				fileOutput = directoryOutput;
+			}
+			// The icon data is normalised so that 0 is the darker colour of the input file and 1 the lighter one
+			iconOutputs.push_back(new BmpSink(fileOutput, std::vector<char>(bitmapHeaders.begin(), bitmapHeaders.begin() + bmpDataOffset), colourTableOffset,
+					(invertBitMap ? colourTable[1] : colourTable[0]), (invertBitMap ? colourTable[0] : colourTable[1]), minimalHeaders, numOutputShards));
+		}
+		else if(format == "atlas") {
+			atlasOutput = new AtlasSink(target, lsbFirst);
+			iconOutputs.push_back(atlasOutput);
+			if(!atlasOutput->isOpen()) {
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed to create output atlas", target);
+				deleteIconOutputs(iconOutputs);
+				return false;
+			}
+		}
+		else if(format == "header") {
+			iconOutputs.push_back(new CHeaderSink(target, lsbFirst));
+		}
+		else if(format == "meta") {
+			iconOutputs.push_back(new MetadataSink(target, turnedCellWidth, turnedCellHeight, iconPlacements));
+		}
+		else if(format == "rle") {
+			// With verbose output every icon is decoded again at the end, to time the decoder
+			rleOutput = new RleSink(target, verbose);
+			iconOutputs.push_back(rleOutput);
+		}
+		else if(format == "rowdict") {
+			rowDictionaryOutput = new RowDictionarySink(target);
+			iconOutputs.push_back(rowDictionaryOutput);
+		}
+		else if(format == "anim") {
+			if(numVariants > 1) {
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Animations can only be written as one variant of each icon, at one scale and not emboldened. Number of variants is", numVariants);
+				bitmapFile.close();
+				deleteIconOutputs(iconOutputs);
+				return false;
+			}
+			// Each row of icons on the sheet is one sequence of frames, which must all be the same size
+			std::vector<uint32_t> iconSequences(icons.size());
+			for(unsigned int i = 0; i < icons.size(); i++) {
+				const bool sameRow = (i > 0) && (icons[i].cellTop == icons[i-1].cellTop);
+				iconSequences[i] = (i == 0) ? 0 : (iconSequences[i-1] + (sameRow ? 0 : 1));
+				if(sameRow && (iconWidths[i] != iconWidths[i-1] || iconHeights[i] != iconHeights[i-1])) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Animation frames in a row of icons must all be the same size. Use --samesize. Differing frame is", i);
+					bitmapFile.close();
+					deleteIconOutputs(iconOutputs);
+					return false;
 				}
-				if(bitsLeftInBitmapByte - numBitsToCopy == 0) {
-					currentBitmapByte++;
+				if(iconHeights[i] > 255) {
+					bitmapInfo.printMessage(ConsoleOutput::ERR, "Animation frames can be no more than 255 lines high. Frame height is", iconHeights[i]);
+					bitmapFile.close();
+					deleteIconOutputs(iconOutputs);
+					return false;
 				}
-				iconCol += numBitsToCopy;
-				bitmapCol += numBitsToCopy;
 			}
+			animationOutput = new AnimationSink(target, iconSequences);
+			iconOutputs.push_back(animationOutput);
+		}
+		else if(format == "neardup") {
+			nearDuplicateOutput = new NearDuplicateSink(target, nearDuplicateDistance);
+			iconOutputs.push_back(nearDuplicateOutput);
+		}
+		else if(format == "pages") {
+			iconOutputs.push_back(new PageSink(target));
+		}
+		else if(format == "a8" || format == "rgb565" || format == "rgba8888") {
+			const PixelFormatSink::pixelFormat_t pixelFormat = (format == "a8") ? PixelFormatSink::A8 : ((format == "rgb565") ? PixelFormatSink::RGB565 : PixelFormatSink::RGBA8888);
+			iconOutputs.push_back(new PixelFormatSink(target, pixelFormat, foregroundColour, backgroundColour));
+		}
+		else if(format == "epd2" || format == "epdplanes") {
+			iconOutputs.push_back(new EpaperSink(target, ((format == "epd2") ? EpaperSink::PACKED : EpaperSink::PLANES), epaperInkCode, epaperBackgroundCode));
+		}
+		else if(format == "sdf") {
+			distanceFieldOutput = new DistanceFieldSink(target, distanceFieldSpread, distanceFieldDownscale);
+			iconOutputs.push_back(distanceFieldOutput);
+		}
+		else if(format == "lvgl" || format == "lvglalpha") {
+			DirectorySink * directoryOutput = new DirectorySink(target, false);
+			if(!directoryOutput->isOpen()) {
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed to open directory for LVGL sources", target);
+				delete directoryOutput;
+				deleteIconOutputs(iconOutputs);
+				return false;
+			}
+			iconOutputs.push_back(new LvglSink(directoryOutput, target, ((format == "lvgl") ? LvglSink::INDEXED : LvglSink::ALPHA), lvglIconsPerSource,
+					foregroundColour, backgroundColour));
 		}
+		else if(format == "packed") {
+			packedOutput = new PackedAtlasSink(target, (invertBitMap ? colourTable[1] : colourTable[0]), (invertBitMap ? colourTable[0] : colourTable[1]), byteAlignedPacking);
+			iconOutputs.push_back(packedOutput);
+		}
+		else {
+			// Every format accepted by the checks on the command line must be created above
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "No output can be created for the format", format);
+			bitmapFile.close();
+			deleteIconOutputs(iconOutputs);
+			return false;
+		}
+	}
 
-		// Use the headers from the original bitmap file to form the foundation of the headers for the individual icons' bitmap files
-		// Copy original bitmap file as far as the start of the bit map data
+	// Outputs of raw pixel data are handed it least significant bit first when asked
+	std::vector<bool> lsbFirstOutputs(iconOutputs.size(), false);
+	for(unsigned int output = 0; output < iconOutputs.size() && lsbFirst; output++) {
+		const std::string & format = outputs[output].first;
+		lsbFirstOutputs[output] = takesLsbFirst(format);
+	}
 
-		// The original header must now be modified for:
-		// 		- the new icon bitmap file size (bmp header)
-		//		- the new icon bitmap width (dib header)
-		//		- the new icon bitmap height (dib header)
-		//		- length of bit map data (dib header)
-		// 		- colours in colour table may need to be swapped around
+	//--------------------------------------------------
+	// Keep the extraction within the maximum memory
+	//--------------------------------------------------
+	// Icons are extracted into the first part of the icon buffer, turned and mirrored between the first and
+	// second parts, emboldened into the next part, scaled into the next, and copied least significant bit
+	// first into the last part for the outputs that take it
+	const bool orienting = (quarterTurns != 0 || mirrorIcons);
+	const bool scaling = (numScales > 1 || scaleFactors[0] != 1);
+	const unsigned int numBuffers = 1 + (orienting ? 1 : 0) + (boldVariants ? 1 : 0) + (scaling ? 1 : 0) + (lsbFirst ? 1 : 0);
+	// Everything held from here until the outputs are finished is counted before any icon is extracted: the band
+	// of bit map rows and the reader's buffers, the icon buffer, and what every output holds on to. Where the bit
+	// map can be read again the band is narrowed to make room, down to the height of the tallest icon
+	uint64_t bytesForOutputs = 0;
+	for(unsigned int output = 0; output < iconOutputs.size() && memoryBudget.isLimited(); output++) {
+		bytesForOutputs += iconOutputs[output]->bytesRetained(iconWidths, iconHeights);
+	}
+	const uint64_t bytesForIcons = bytesForIconEntries(icons.size(), numVariants);
+	const uint64_t bytesBesideBand = sheet.readerBytes() + bytesForIcons + ((uint64_t)numBuffers * largestIconArraySize) + bytesForOutputs;
+	const unsigned int bandRowsForEntries = sheet.capacityRows();
+	if(!fitBand(sheet, memoryBudget, bytesBesideBand, maxIconHeight, stayingWhole, bytesInImageRow)) {
+		bitmapInfo.printMessage(ConsoleOutput::ERR, "Maximum memory is too small to extract the icons and hold them for the outputs. Bytes available are", memoryBudget.bytesForData());
+		bitmapInfo.printMessage(ConsoleOutput::ERR, "Bytes required are", bytesBesideBand + (stayingWhole ? sheet.sizeInBytes() : SheetBuffer::allocationBytes((uint64_t)maxIconHeight * bytesInImageRow)));
+		bitmapFile.close();
+		deleteIconOutputs(iconOutputs);
+		return false;
+	}
+	if(verbose && sheet.capacityRows() != bandRowsForEntries) {
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Bit map will be read in bands of", sheet.capacityRows(), "rows while extracting icons");
+	}
+	if(memoryBudget.isLimited() && verbose) {
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Memory held by the outputs until they are finished is", bytesForOutputs, "bytes");
+	}
+	// The distance fields are computed by as many workers as there is room for, beyond the one the output counts
+	if(memoryBudget.isLimited() && distanceFieldOutput != NULL) {
+		const uint64_t bytesLeft = memoryBudget.bytesForData() - std::min(memoryBudget.bytesForData(), sheet.sizeInBytes() + bytesBesideBand);
+		const uint64_t bytesPerWorker = std::max<uint64_t>(1, distanceFieldOutput->bytesForWorker(iconWidths, iconHeights));
+		distanceFieldOutput->limitWorkers(1 + std::min<uint64_t>(bytesLeft / bytesPerWorker, std::max(1u, std::thread::hardware_concurrency())));
+	}
 
-		// Copy start of original bitmap file right up to the start of the bit map data
-		bitmapFile.seekg(0);
-		char * buffer = new char[bmpDataOffset];
-		bitmapFile.read(buffer,bmpDataOffset);
-		if(!bitmapFile) {
-			bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to read all headers from bitmap file. Failed after", bitmapFile.gcount(), "bytes");
-			bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected to read", bmpDataOffset, "bytes");
+	for(unsigned int output = 0; output < iconOutputs.size(); output++) {
+		if(!iconOutputs[output]->begin(iconWidths, iconHeights)) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed to create output", outputs[output].second);
 			bitmapFile.close();
-			iconFile.close();
+			deleteIconOutputs(iconOutputs);
 			return false;
 		}
-		iconFile.write(buffer, bmpDataOffset);
-		if(!iconFile) {
-			bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to write all headers to icon file. Failed after", bitmapFile.gcount(), "bytes");
-			bitmapInfo.printMessage(ConsoleOutput::ERR, "Expected to write", bmpDataOffset, "bytes");
+	}
+
+	if(iconOutputs.size() == 1 && atlasOutput != NULL && sheet.holdsWholeSheet() && numVariants == 1 && scaleFactors[0] == 1) {
+		// When the atlas is the only output and every icon can be reached without reading the file again,
+		// the icons are shared out between worker threads, each of which extracts its icons straight into
+		// their slots in the atlas mapping
+		if(!sheet.load(0, dibImageHeight)) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to read sufficent bytes from bit map to fill a row in the framebuffer", "");
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed on image line", sheet.failedRow());
 			bitmapFile.close();
-			iconFile.close();
+			deleteIconOutputs(iconOutputs);
 			return false;
 		}
-
-		// Calculate new file size and write it to iconFile
-		const uint32_t iconFileDataSize = (4* ceil( ceil((double)iconWidth/8) /4)) * iconHeight;
-		const uint32_t iconCalculatedFileSize = bmpDataOffset + iconFileDataSize;
-		iconFile.seekp(2);
-		iconFile.write((char *)&iconCalculatedFileSize, sizeof(uint32_t));
+		unsigned int numWorkers = std::min<unsigned int>(std::max(1u, std::thread::hardware_concurrency()), icons.size());
+		// Workers turning and mirroring icons each have two icon buffers of their own, which there is room for
+		// at least one set of in place of the serial extraction's buffer
+		if(memoryBudget.isLimited() && orienting) {
+			const uint64_t bytesLeft = memoryBudget.bytesForData() - std::min(memoryBudget.bytesForData(), sheet.sizeInBytes() + sheet.readerBytes() + bytesForIcons + bytesForOutputs);
+			numWorkers = std::max<uint64_t>(1, std::min<uint64_t>(numWorkers, bytesLeft / (2 * largestIconArraySize)));
+		}
+		std::vector<std::future<void>> workers;
+		for(unsigned int worker = 0; worker < numWorkers; worker++) {
+			workers.push_back(std::async(std::launch::async, extractIconsIntoAtlas, std::cref(sheet), std::cref(icons), std::cref(sheetIconWidths),
+					std::cref(sheetIconHeights), storedHorizontalMargin, storedVerticalMargin, quarterTurns, mirrorIcons, lsbFirst, std::ref(*atlasOutput),
+					(icons.size() * worker) / numWorkers, (icons.size() * (worker + 1)) / numWorkers));
+		}
+		for(unsigned int worker = 0; worker < numWorkers; worker++) {
+			workers[worker].get();
+		}
 		if(verbose) {
-			bitmapInfo.printMessage(ConsoleOutput::INFO, "Size of icon file calculated to be", iconCalculatedFileSize, "bytes");
+			bitmapInfo.printMessage(ConsoleOutput::INFO, "Icons were extracted by worker threads numbering", numWorkers);
 		}
+	}
+	else {
+		// Each icon is extracted once, in the order the bands of the bit map are read, and handed to every output
+		uint8_t * iconBuffers = new uint8_t[largestIconArraySize * numBuffers];
+		uint8_t * scratchData = orienting ? (iconBuffers + largestIconArraySize) : NULL;
+		uint8_t * boldData = boldVariants ? (iconBuffers + (largestIconArraySize * (orienting ? 2 : 1))) : NULL;
+		uint8_t * scaledData = scaling ? (iconBuffers + (largestIconArraySize * (numBuffers - (lsbFirst ? 2 : 1)))) : NULL;
+		uint8_t * lsbFirstData = lsbFirst ? (iconBuffers + (largestIconArraySize * (numBuffers - 1))) : NULL;
+		for(unsigned int i = 0; i < icons.size(); i++) {
+			if(verbose) {
+				cout << endl;
+				bitmapInfo.printHeading("Icon information");
+			}
+			// Create numbered names with enough leading zeroes so that the lowest numbers are the same length as the highest
+			std::string iconName = std::to_string(i);
+			iconName.insert(0,(std::to_string(icons.size()).size() - iconName.size()),'0');
 
-		// Write icon dimensions to iconFile
-		// Position:18-21, Length:4, Info: Image width in pixels
-		iconFile.seekp(18);
-		iconFile.write((char *)&iconWidth, sizeof(uint32_t));
-		// Position 22-25, Length:4, Info: Image height in pixels
-		iconFile.seekp(22);
-		iconFile.write((char *)&iconHeight, sizeof(uint32_t));
-
+			if(verbose) {
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Horizontal margin of", storedHorizontalMargin, "pixels added to this icon");
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Vertical margin of", storedVerticalMargin, "pixels added to this icon");
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Icon pixel width including margin is", orientedIconWidths[i]);
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Icon pixel height including margin is", orientedIconHeights[i]);
+				bitmapInfo.printMessage(ConsoleOutput::INFO, "Size of array required to hold this icon is", AtlasSink::bytesForIcon(orientedIconWidths[i], orientedIconHeights[i]));
+			}
 
-		// Write length of bit map data to icon file
-		// Position 34-37, Length:4, Info: length of bit map data within the bitmap file
-		iconFile.seekp(34);
-		iconFile.write((char *)&iconFileDataSize, sizeof(uint32_t));
+			if(!loadIconRows(sheet, icons[i], dibImageHeight)) {
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to read sufficent bytes from bit map to fill a row in the framebuffer", "");
+				bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed on image line", sheet.failedRow());
+				bitmapFile.close();
+				delete[] iconBuffers;
+				deleteIconOutputs(iconOutputs);
+				return false;
+			}
+			extractIcon(sheet, icons[i], sheetIconWidths[i], sheetIconHeights[i], storedHorizontalMargin, storedVerticalMargin, iconBuffers);
+			const uint8_t * orientedData = orientIcon(iconBuffers, scratchData, sheetIconWidths[i], sheetIconHeights[i], quarterTurns, mirrorIcons);
 
-		if(invertBitMap) {
-			iconFile.seekp(colourTableOffset);
-			// A bit lazy but now cofirmed that the colour table is only for 2 colours
-			iconFile.write((char *)(&colourTable[1]), sizeof(uint32_t));
-			iconFile.write((char *)(&colourTable[0]), sizeof(uint32_t));
+			for(unsigned int variant = 0; variant < numVariants; variant++) {
+				const unsigned int outputIcon = (i * numVariants) + variant;
+				const unsigned int factor = scaleFactors[variant % numScales];
+				const std::string outputName = iconName + variantSuffixes[variant];
+				const uint8_t * variantData = orientedData;
+				uint32_t variantWidth = orientedIconWidths[i];
+				uint32_t variantHeight = orientedIconHeights[i];
+				if(variant >= numScales) {
+					// The emboldened icon is made once and then scaled like the plain one
+					if(variant == numScales) {
+						Morphology::embolden(orientedData, orientedIconWidths[i], orientedIconHeights[i], boldData);
+					}
+					variantData = boldData;
+					variantWidth += 2;
+					variantHeight += 2;
+				}
+				const uint8_t * iconData = variantData;
+				if(factor != 1) {
+					BitKernels::scale(variantData, variantWidth, variantHeight, factor, scaledData);
+					iconData = scaledData;
+				}
+				if(lsbFirst) {
+					BitKernels::reverseBitOrder(iconData, AtlasSink::bytesForIcon(iconWidths[outputIcon], iconHeights[outputIcon]), lsbFirstData);
+				}
+				for(unsigned int output = 0; output < iconOutputs.size(); output++) {
+					if(!iconOutputs[output]->writeIcon(outputIcon, outputName, (lsbFirstOutputs[output] ? lsbFirstData : iconData), iconWidths[outputIcon], iconHeights[outputIcon])) {
+						bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed to write icon", iconOutputs[output]->describe(outputName));
+						bitmapFile.close();
+						delete[] iconBuffers;
+						deleteIconOutputs(iconOutputs);
+						return false;
+					}
+					if(verbose) {
+						bitmapInfo.printMessage(ConsoleOutput::INFO, "Successfully wrote icon", iconOutputs[output]->describe(outputName));
+					}
+				}
+			}
 		}
+		delete[] iconBuffers;
+	}
 
-		// Write iconData to iconFile
-		// extra padding bytes must be written to the end of each line
-		unsigned int bytesInIconRow = ceil((double)iconWidth/8);
-		unsigned int numPaddingBytes = 0;
-		if(bytesInIconRow%4 != 0) {
-			numPaddingBytes = 4-(bytesInIconRow%4);
-		}
-		char * paddingBytes = new char[numPaddingBytes];
-		for(uint8_t i=0; i<numPaddingBytes; i++) {
-			paddingBytes[i] = 0xFF;
-		}
-		iconFile.seekp(bmpDataOffset);
-		if(!iconFile) {
-			bitmapInfo.printMessage(ConsoleOutput::ERR, "Unable to seek to start of iconData in iconFile for writing", "");
-			bitmapFile.close();
-			iconFile.close();
-			return false;
-		}
-		for(unsigned int row=0; row<iconHeight; row++) {
-//			cout << "iconFile to be written at position " << iconFile.tellp() << endl;
-			unsigned int iconDataOffset = (iconArraySize-((row+1)*bytesInIconRow));
-//			cout << "iconDataOffset is " << iconDataOffset << endl;
-			iconFile.write((char*)&iconData[iconDataOffset] ,bytesInIconRow);
-			if(numPaddingBytes != 0) {
-				iconFile.write(paddingBytes, numPaddingBytes);
-			}
-		}
-
-		// check measured file size of iconFile against its calculated file size.
-		// get iconFile size
-		iconFile.seekp(0, iconFile.end);
-		const unsigned int iconActualFileSize = iconFile.tellp();
-		iconFile.seekp(0, iconFile.beg);
-		if(iconActualFileSize != iconCalculatedFileSize) {
-			bitmapInfo.printMessage(ConsoleOutput::ERR,	"Size calculated for iconFIle is different to actual size of iconFile", fileNumber);
-			bitmapInfo.printMessage(ConsoleOutput::ERR,	"Calculated size for iconFile is", iconCalculatedFileSize, "bytes");
-			bitmapInfo.printMessage(ConsoleOutput::ERR,	"Actual size for iconFile is    ", iconActualFileSize, "bytes");
+	if(atlasOutput != NULL && verbose) {
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Number of icons written to the atlas is", iconWidths.size());
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Size of the atlas file is", atlasOutput->sizeInBytes(), "bytes");
+	}
+	if(packedOutput != NULL && verbose) {
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Pixel width of the packed atlas is", packedOutput->width());
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Pixel height of the packed atlas is", packedOutput->height());
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Time spent packing the icons was", packedOutput->millisecondsPacking(), "ms");
+	}
+	for(unsigned int output = 0; output < iconOutputs.size(); output++) {
+		if(!iconOutputs[output]->finish()) {
+			bitmapInfo.printMessage(ConsoleOutput::ERR, "Failed to complete the output", (outputs[output].second.empty() ? "." : outputs[output].second));
 			bitmapFile.close();
-			iconFile.close();
+			deleteIconOutputs(iconOutputs);
 			return false;
 		}
-
-		if(verbose) {
-			bitmapInfo.printMessage(ConsoleOutput::INFO, "Successfully created icon file", fileNumber);
-		}
-
-		//--------------------------------------------------
-		// Delete dynamically allocated memory for icon file
-		//--------------------------------------------------
-		delete[] paddingBytes;
-		delete[] buffer;
-		delete[] iconData;
-		iconFile.close();
-
 	}
+	if(rleOutput != NULL && verbose) {
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Size of the icon data before run length encoding was", rleOutput->sizeUncompressed(), "bytes");
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Size of the icon data after run length encoding is", rleOutput->sizeOfBlocks(), "bytes");
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Every run length encoded icon decoded to the bytes it was encoded from", "");
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Time spent decoding every run length encoded icon was", rleOutput->microsecondsDecoding(), "us");
+	}
+	if(rowDictionaryOutput != NULL && verbose) {
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Number of rows in all icons is", rowDictionaryOutput->numIconRows());
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Number of distinct rows in the row dictionary is", rowDictionaryOutput->numDistinctRows());
+	}
+	if(animationOutput != NULL && verbose) {
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Bytes of LCD commands to send every animation frame in full would be", animationOutput->sizeOfFullFrames());
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Bytes of LCD commands to send only the changed lines are", animationOutput->sizeOfChangedLines());
+	}
+	if(distanceFieldOutput != NULL && verbose) {
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Pixel width of the distance field atlas is", distanceFieldOutput->width());
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Pixel height of the distance field atlas is", distanceFieldOutput->height());
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Distance fields were computed by worker threads numbering", distanceFieldOutput->workersTransforming());
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Time spent computing the distance fields was", distanceFieldOutput->millisecondsTransforming(), "ms");
+	}
+	if(nearDuplicateOutput != NULL && verbose) {
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Number of pairs of icons compared for near duplicates was", nearDuplicateOutput->comparisons());
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Number of pairs of near duplicate icons found is", nearDuplicateOutput->pairsFound());
+	}
+	deleteIconOutputs(iconOutputs);
 
 	//--------------------------------------------------
 	// Delete dynamically allocated memory for bitmap file
 	//--------------------------------------------------
 	delete[] colourTable;
-	delete[] bitmapData;
 	bitmapFile.close();
+
+	if(verbose) {
+		cout << endl;
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Time spent reading bit map data was", sheet.millisecondsReading(), "ms");
+	}
+	if(verbose || memoryBudget.isLimited()) {
+		const uint64_t peakResidentBytes = MemoryBudget::peakResidentBytes();
+		bitmapInfo.printMessage(ConsoleOutput::INFO, "Peak resident set size was", peakResidentBytes/1024, "KiB");
+		if(memoryBudget.isLimited() && peakResidentBytes > memoryBudget.limit()) {
+			bitmapInfo.printMessage(ConsoleOutput::WARN, "Peak resident set size exceeded the maximum memory of", memoryBudget.limit()/1024, "KiB");
+		}
+	}
 	return 0;
 }
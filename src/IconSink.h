@@ -0,0 +1,73 @@
+//============================================================================
+// Name			: Icon Sink (IconSink.h)
+// Description 	: Interface for the outputs that extracted icons are handed to,
+//				: so that one extraction pass can feed several output formats
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _ICON_SINK_LIB_H
+#define _ICON_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Base class for the outputs that extracted icons are written to. Each icon is extracted once and
+// then handed to every output in turn, in icon order.
+// Icon data is held as ceil(width/8) bytes per row, rows from top to bottom, most significant
+// bit first, with 0 for black and 1 for white. Padding bits at the end of each row are 1.
+class IconSink {
+
+public:
+	// Allowance for an icon's name, such as 0001@bold@2x, when estimating the memory an output holds on to
+	static const uint32_t nameAllowance = 32;
+
+	virtual ~IconSink() {
+		//
+	}
+
+
+	// Called once, before any icon is written, with the dimensions of every icon
+	virtual bool begin(const std::vector<uint32_t> & /*iconWidths*/, const std::vector<uint32_t> & /*iconHeights*/) {
+		return true;
+	}
+
+
+	// Writes one icon. icon is its position in the list of icons and name its zero-padded number.
+	virtual bool writeIcon(uint32_t icon, const std::string & name, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) = 0;
+
+
+	// Completes the output once every icon has been written
+	virtual bool finish() = 0;
+
+
+	// Where an icon of the given name ends up. For messages.
+	virtual std::string describe(const std::string & name) const = 0;
+
+
+	// Bytes of memory the output holds on to, at most, from begin() to the end of finish() for icons of the given
+	// dimensions. Lets --maxmemory refuse outputs that cannot fit before any icon is extracted.
+	virtual uint64_t bytesRetained(const std::vector<uint32_t> & /*iconWidths*/, const std::vector<uint32_t> & /*iconHeights*/) const {
+		return 0;
+	}
+
+};
+#endif
@@ -0,0 +1,186 @@
+//============================================================================
+// Name			: Input Pipe (InputPipe.h)
+// Description 	: Presents standard input, or a gzip or zstd compressed file,
+//				: as a sequential std::istream. Decompression is done by a
+//				: child gzip or zstd process running alongside this program.
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _INPUT_PIPE_LIB_H
+#define _INPUT_PIPE_LIB_H
+
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+extern char ** environ;
+
+// Class for reading standard input or the output of a decompressor one buffer at a time
+class InputPipe : private std::streambuf {
+
+public:
+	// Enumerator for the compression applied to the input
+	enum compression_t {NONE, GZIP, ZSTD};
+
+private:
+	int fd;
+	pid_t child;
+	char buffer[64 * 1024];
+	std::istream stream;
+
+	InputPipe(const InputPipe &);
+	InputPipe & operator=(const InputPipe &);
+
+	// Refills the buffer from the pipe when the istream has used it up
+	int_type underflow() {
+		if(gptr() < egptr()) {
+			return traits_type::to_int_type(*gptr());
+		}
+		ssize_t bytesRead = 0;
+		do {
+			bytesRead = read(fd, buffer, sizeof(buffer));
+		} while(bytesRead < 0 && errno == EINTR);
+		if(bytesRead <= 0) {
+			return traits_type::eof();
+		}
+		setg(buffer, buffer, buffer + bytesRead);
+		return traits_type::to_int_type(*gptr());
+	}
+
+public:
+	// Constructor
+	InputPipe() : fd(-1), child(-1), stream(this) {
+		setg(buffer, buffer, buffer);
+	}
+
+
+	// Input left unfinished, e.g. after an error, is abandoned rather than read to the end
+	~InputPipe() {
+		abandon();
+	}
+
+
+	// Guesses the compression of a file from its name
+	static compression_t compressionFromName(const std::string & path) {
+		if(path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0) {
+			return GZIP;
+		}
+		if(path.size() > 4 && path.compare(path.size() - 4, 4, ".zst") == 0) {
+			return ZSTD;
+		}
+		return NONE;
+	}
+
+
+	// Opens the input. A path of "-" is standard input. Compressed input is piped through
+	// "gzip -dc" or "zstd -dc", which must be on the PATH.
+	bool open(const std::string & path, compression_t compression) {
+		if(compression == NONE) {
+			if(path == "-") {
+				fd = STDIN_FILENO;
+			}
+			else {
+				fd = ::open(path.c_str(), O_RDONLY);
+			}
+			return fd >= 0;
+		}
+		int pipeEnds[2];
+		if(pipe(pipeEnds) != 0) {
+			return false;
+		}
+		posix_spawn_file_actions_t actions;
+		posix_spawn_file_actions_init(&actions);
+		if(path != "-") {
+			posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, path.c_str(), O_RDONLY, 0);
+		}
+		posix_spawn_file_actions_adddup2(&actions, pipeEnds[1], STDOUT_FILENO);
+		posix_spawn_file_actions_addclose(&actions, pipeEnds[0]);
+		posix_spawn_file_actions_addclose(&actions, pipeEnds[1]);
+		const char * program = (compression == GZIP) ? "gzip" : "zstd";
+		char * const arguments[] = {(char *)program, (char *)"-dc", NULL};
+		const int result = posix_spawnp(&child, program, &actions, NULL, arguments, environ);
+		posix_spawn_file_actions_destroy(&actions);
+		close(pipeEnds[1]);
+		if(result != 0) {
+			close(pipeEnds[0]);
+			child = -1;
+			return false;
+		}
+		fd = pipeEnds[0];
+		return true;
+	}
+
+
+	std::istream & input() {
+		return stream;
+	}
+
+
+	// Discards whatever is left of the input and waits for the decompressor to exit.
+	// Returns false if the decompressor reported an error, e.g. for a corrupt or truncated file.
+	bool finish() {
+		bool success = true;
+		if(child > 0) {
+			char discard[4096];
+			while(read(fd, discard, sizeof(discard)) > 0) {
+				//
+			}
+			int status = 0;
+			while(waitpid(child, &status, 0) < 0 && errno == EINTR) {
+				//
+			}
+			success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+			child = -1;
+		}
+		if(fd > STDIN_FILENO) {
+			close(fd);
+		}
+		fd = -1;
+		return success;
+	}
+
+
+	// Stops the decompressor without reading the rest of its output, for when the input is not wanted any
+	// more. The pipe is closed first, so a decompressor that survives the signal fails at its next write
+	void abandon() {
+		if(fd > STDIN_FILENO) {
+			close(fd);
+		}
+		fd = -1;
+		if(child > 0) {
+			kill(child, SIGTERM);
+			while(waitpid(child, NULL, 0) < 0 && errno == EINTR) {
+				//
+			}
+			child = -1;
+		}
+	}
+
+};
+#endif
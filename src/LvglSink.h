@@ -0,0 +1,208 @@
+//============================================================================
+// Name			: LVGL Sink (LvglSink.h)
+// Description 	: Writes every icon as LVGL image data and descriptors, in C
+//				: sources of a limited number of icons each, with a header
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+
+#ifndef _LVGL_SINK_LIB_H
+#define _LVGL_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cctype>
+#include <stdint.h>
+
+#include "IconSink.h"
+#include "FileSink.h"
+
+// Class for writing every icon as an lv_img_dsc_t image descriptor for the LVGL graphics library, with
+// its pixel data, in a directory of C sources. Each source holds a limited number of consecutive icons, so
+// that no one file takes too long to compile. A header declares every descriptor.
+// Identifiers are prefixed with the name of the directory, e.g. ui/icons holds icons.h declaring icons_000,
+// and icons_00.c, icons_01.c ... defining them.
+// Icons are either LV_IMG_CF_INDEXED_1BIT, a palette of ink and background colours followed by rows of
+// pixel indices, 0 for ink, or LV_IMG_CF_ALPHA_1BIT, rows with ink set opaque and drawn in the recolour
+// of the image's style. Rows are whole bytes, most significant bit first. LVGL image headers hold widths
+// and heights up to 2047 pixels.
+class LvglSink : public IconSink {
+
+public:
+	enum colourFormat_t {INDEXED, ALPHA};
+	static const uint32_t maxDimension = 2047;
+
+private:
+	FileSink * files;
+	const colourFormat_t format;
+	const unsigned int iconsPerSource;
+	const uint32_t inkColour;			// 0xRRGGBBAA
+	const uint32_t backgroundColour;
+	std::string prefix;
+	std::string guard;
+	std::string header;
+	std::string source;
+	uint32_t numIcons;
+	unsigned int numberLength;			// digits in the number of each source
+
+	LvglSink(const LvglSink &);
+	LvglSink & operator=(const LvglSink &);
+
+	std::string sourceName(uint32_t icon) const {
+		std::string number = std::to_string(icon / iconsPerSource);
+		number.insert(0, (numberLength - number.size()), '0');
+		return prefix + "_" + number + ".c";
+	}
+
+
+	// Palette entries are lv_color32_t, which is stored blue, green, red, alpha
+	static void appendPaletteEntry(std::string & text, uint32_t colour) {
+		char entry[32];
+		snprintf(entry, sizeof(entry), "0x%02X,0x%02X,0x%02X,0x%02X,", (colour >> 8) & 0xFF, (colour >> 16) & 0xFF, colour >> 24, colour & 0xFF);
+		text += entry;
+	}
+
+
+	static std::string includeLvgl() {
+		return "#ifdef LV_LVGL_H_INCLUDE_SIMPLE\n#include \"lvgl.h\"\n#else\n#include \"lvgl/lvgl.h\"\n#endif\n";
+	}
+
+public:
+	// Constructor. Takes ownership of files, which writes into directory. Colours are 0xRRGGBBAA and are only
+	// used by the indexed format
+	LvglSink(FileSink * fileSink, const std::string & directory, colourFormat_t colourFormat, unsigned int iconsInEachSource,
+			uint32_t ink, uint32_t background) : files(fileSink), format(colourFormat), iconsPerSource(iconsInEachSource),
+			inkColour(ink), backgroundColour(background), numIcons(0), numberLength(1) {
+		const std::string::size_type end = directory.find_last_not_of('/') + 1;
+		const std::string::size_type slash = (end == 0) ? std::string::npos : directory.rfind('/', end - 1);
+		const std::string dirName = directory.substr(0, end).substr((slash == std::string::npos) ? 0 : slash + 1);
+		for(std::string::size_type i = 0; i < dirName.size() && dirName[i] != '.'; i++) {
+			prefix += isalnum((unsigned char)dirName[i]) ? dirName[i] : '_';
+		}
+		if(prefix.empty()) {
+			prefix = "icons";
+		}
+		else if(isdigit((unsigned char)prefix[0])) {
+			prefix = "icons_" + prefix;
+		}
+		for(std::string::size_type i = 0; i < prefix.size(); i++) {
+			guard += toupper((unsigned char)prefix[i]);
+		}
+	}
+
+
+	~LvglSink() {
+		delete files;
+	}
+
+
+	bool begin(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & /*iconHeights*/) {
+		numIcons = iconWidths.size();
+		numberLength = std::to_string((numIcons + iconsPerSource - 1) / iconsPerSource).size();
+		header = "// LVGL image descriptors of the icons, " + std::string((format == INDEXED) ? "LV_IMG_CF_INDEXED_1BIT" : "LV_IMG_CF_ALPHA_1BIT") + "\n";
+		header += "#ifndef " + guard + "_H\n#define " + guard + "_H\n\n" + includeLvgl() + "\n";
+		header += "#define " + guard + "_COUNT " + std::to_string(numIcons) + "\n\n";
+		return true;
+	}
+
+
+	bool writeIcon(uint32_t icon, const std::string & name, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		if(iconWidth > maxDimension || iconHeight > maxDimension) {
+			return false;
+		}
+		const uint32_t bytesInIconRow = (iconWidth + 7) / 8;
+		const uint32_t dataSize = (bytesInIconRow * iconHeight) + ((format == INDEXED) ? 8 : 0);
+		// Names such as 0001@2x become identifiers such as icons_0001_2x
+		std::string identifier = prefix + "_" + name;
+		for(std::string::size_type i = prefix.size(); i < identifier.size(); i++) {
+			identifier[i] = isalnum((unsigned char)identifier[i]) ? identifier[i] : '_';
+		}
+		if(icon % iconsPerSource == 0) {
+			source = "// LVGL image descriptors of the icons declared in " + prefix + ".h\n" + includeLvgl();
+			source += "\n#ifndef LV_ATTRIBUTE_MEM_ALIGN\n#define LV_ATTRIBUTE_MEM_ALIGN\n#endif\n\n";
+		}
+
+		char number[16];
+		snprintf(number, sizeof(number), "%u x %u", iconWidth, iconHeight);
+		source += "// " + name + ": " + number + " pixels\n";
+		source += "static const LV_ATTRIBUTE_MEM_ALIGN uint8_t " + identifier + "_map[] = {\n";
+		if(format == INDEXED) {
+			source += "\t";
+			appendPaletteEntry(source, inkColour);
+			appendPaletteEntry(source, backgroundColour);
+			source += "\n";
+		}
+		// Alpha is the inverse of the icon data, so that ink is opaque and the padding transparent
+		const uint8_t invert = (format == ALPHA) ? 0xFF : 0x00;
+		for(uint32_t row = 0; row < iconHeight; row++) {
+			source += "\t";
+			for(uint32_t byte = 0; byte < bytesInIconRow; byte++) {
+				snprintf(number, sizeof(number), "0x%02X,", iconData[((uint64_t)row * bytesInIconRow) + byte] ^ invert);
+				source += number;
+			}
+			source += "\n";
+		}
+		source += "};\n\n";
+		source += "const lv_img_dsc_t " + identifier + " = {\n";
+		source += "\t.header.cf = " + std::string((format == INDEXED) ? "LV_IMG_CF_INDEXED_1BIT" : "LV_IMG_CF_ALPHA_1BIT") + ",\n";
+		source += "\t.header.always_zero = 0,\n\t.header.reserved = 0,\n";
+		source += "\t.header.w = " + std::to_string(iconWidth) + ",\n";
+		source += "\t.header.h = " + std::to_string(iconHeight) + ",\n";
+		source += "\t.data_size = " + std::to_string(dataSize) + ",\n";
+		source += "\t.data = " + identifier + "_map,\n};\n\n";
+		header += "LV_IMG_DECLARE(" + identifier + ");\n";
+
+		// Each source is written out once its last icon has arrived
+		if(icon % iconsPerSource == iconsPerSource - 1 || icon == numIcons - 1) {
+			return files->writeFile(sourceName(icon), source.data(), source.size());
+		}
+		return true;
+	}
+
+
+	// The source of the icons in the largest group, and the header declaring every icon, which strings may hold
+	// twice over as they grow
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		const uint64_t identifierBytes = prefix.size() + 1 + nameAllowance;
+		uint64_t largestIconText = 0;
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			// Each byte is written as 0xFF, and each row as a tab, the bytes and a newline, followed by the descriptor
+			largestIconText = std::max(largestIconText, ((uint64_t)iconHeights[i] * ((5 * ((iconWidths[i] + 7) / 8)) + 2)) + (3 * identifierBytes) + 512);
+		}
+		const uint64_t iconsInSource = std::min<uint64_t>(iconsPerSource, iconWidths.size());
+		return 2 * ((iconsInSource * largestIconText) + ((uint64_t)iconWidths.size() * (identifierBytes + 20)));
+	}
+
+
+	bool finish() {
+		header += "\n#endif\n";
+		return files->writeFile(prefix + ".h", header.data(), header.size()) && files->finish();
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return prefix + "_" + name + " in " + files->describe(prefix + "_*.c");
+	}
+
+};
+#endif
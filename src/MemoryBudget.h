@@ -0,0 +1,102 @@
+//============================================================================
+// Name			: Memory Budget (MemoryBudget.h)
+// Description 	: Tracks an optional upper limit on the memory the program may
+//				: use and reports the resident set size of the process
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _MEMORY_BUDGET_LIB_H
+#define _MEMORY_BUDGET_LIB_H
+
+#include <stdint.h>
+
+#include <algorithm>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+// Class for keeping the large buffers of the program within a fixed memory limit
+class MemoryBudget {
+
+private:
+	uint64_t limitBytes;		// 0 means no limit has been set
+	uint64_t baselineBytes;		// resident set size when the budget was created or last settled
+
+public:
+	// Kept back from the data buffers for the code and library pages that are only touched once
+	// they first run, and for the small allocations that no buffer accounts for
+	static const uint64_t runtimeAllowance = 512 * 1024;
+
+	// Constructor
+	MemoryBudget() : limitBytes(0), baselineBytes(peakResidentBytes()) {
+		//
+	}
+
+
+	// Sets the limit on the peak resident set size of the whole process
+	void setLimit(const uint64_t bytes) {
+		limitBytes = bytes;
+	}
+
+
+	// Has a limit been set?
+	bool isLimited() const {
+		return limitBytes != 0;
+	}
+
+
+	uint64_t limit() const {
+		return limitBytes;
+	}
+
+
+	// Counts everything resident so far, such as the input file's stream buffers and headers, as outside
+	// the data buffers. Called once the input is open and before any large buffer is allocated
+	void settle() {
+		baselineBytes = std::max(baselineBytes, peakResidentBytes());
+	}
+
+
+	// Number of bytes left for data buffers once the code, libraries and stack already resident
+	// and the runtime allowance have been accounted for. Unlimited budgets report UINT64_MAX.
+	uint64_t bytesForData() const {
+		if(!isLimited()) {
+			return UINT64_MAX;
+		}
+		if(limitBytes <= baselineBytes + runtimeAllowance) {
+			return 0;
+		}
+		return limitBytes - baselineBytes - runtimeAllowance;
+	}
+
+
+	// Peak resident set size of the process so far, in bytes
+	static uint64_t peakResidentBytes() {
+		struct rusage usage;
+		if(getrusage(RUSAGE_SELF, &usage) != 0) {
+			return 0;
+		}
+		// ru_maxrss is reported in kilobytes on Linux
+		return (uint64_t)usage.ru_maxrss * 1024;
+	}
+
+};
+#endif
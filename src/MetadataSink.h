@@ -0,0 +1,106 @@
+//============================================================================
+// Name			: Metadata Sink (MetadataSink.h)
+// Description 	: Writes a text table describing every icon: its stored size
+//				: and where it sits within the uniform icon cell and within
+//				: the grid cell it was found in on the sheet
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _METADATA_SINK_LIB_H
+#define _METADATA_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <stdint.h>
+
+#include "IconSink.h"
+#include "Crc32c.h"
+
+// Position of the top left corner of a stored icon image. Negative where margins extend the image
+// beyond the cell.
+struct iconPlacement {
+	int32_t cellX;		// within the uniform cell of the size every icon is padded out to by --samesize
+	int32_t cellY;
+	int32_t gridX;		// within the row/column grid cell the icon was found in on the sheet
+	int32_t gridY;
+};
+
+// Class for writing a comma separated table with one line per icon:
+//   name,width,height,cell_x,cell_y,grid_x,grid_y,crc32c
+// preceded by a comment line giving the size of the uniform cell. crc32c is the CRC-32C, in hexadecimal,
+// of the icon's pixel data as stored in the atlas and other raw outputs: ceil(width/8) bytes per row.
+class MetadataSink : public IconSink {
+
+private:
+	const std::string path;
+	const uint32_t cellWidth;
+	const uint32_t cellHeight;
+	const std::vector<iconPlacement> placements;
+	std::ofstream table;
+
+	MetadataSink(const MetadataSink &);
+	MetadataSink & operator=(const MetadataSink &);
+
+public:
+	// Constructor
+	MetadataSink(const std::string & tablePath, uint32_t uniformCellWidth, uint32_t uniformCellHeight, const std::vector<iconPlacement> & iconPlacements) :
+		path(tablePath), cellWidth(uniformCellWidth), cellHeight(uniformCellHeight), placements(iconPlacements) {
+		//
+	}
+
+
+	bool begin(const std::vector<uint32_t> & /*iconWidths*/, const std::vector<uint32_t> & /*iconHeights*/) {
+		table.open(path.c_str(), (std::ofstream::out | std::ofstream::trunc));
+		table << "# cell " << cellWidth << " x " << cellHeight << "\n";
+		table << "name,width,height,cell_x,cell_y,grid_x,grid_y,crc32c\n";
+		return !table.fail();
+	}
+
+
+	bool writeIcon(uint32_t icon, const std::string & name, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		const iconPlacement & placement = placements[icon];
+		table << name << ',' << iconWidth << ',' << iconHeight << ',' << placement.cellX << ',' << placement.cellY
+				<< ',' << placement.gridX << ',' << placement.gridY << ',' << std::hex << std::setw(8) << std::setfill('0')
+				<< Crc32c::compute(iconData, ((iconWidth + 7) / 8) * iconHeight) << std::dec << '\n';
+		return !table.fail();
+	}
+
+
+	bool finish() {
+		table.close();
+		return !table.fail();
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return "entry " + name + " of " + path;
+	}
+
+
+	// The placement of every icon
+	uint64_t bytesRetained(const std::vector<uint32_t> & /*iconWidths*/, const std::vector<uint32_t> & /*iconHeights*/) const {
+		return (uint64_t)placements.size() * sizeof(iconPlacement);
+	}
+
+};
+#endif
@@ -0,0 +1,194 @@
+//============================================================================
+// Name			: Morphology (Morphology.h)
+// Description 	: Erosion, dilation, opening and closing of one bit images,
+//				: worked on 64 pixels at a time
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+
+#ifndef _MORPHOLOGY_LIB_H
+#define _MORPHOLOGY_LIB_H
+
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+
+// Images are held as everywhere else in the program: ceil(width/8) bytes per row from top to bottom,
+// most significant bit first, 0 for ink and the padding bits at the end of each row set to 1.
+// Each operator works with the 3x3 square around every pixel. Rows are loaded into 64 bit words with
+// ink as 1, so that a whole word of pixels is compared with its neighbours using shifts, and the pixels
+// beyond the edges of the image count as background. Every operator may be run in place.
+namespace Morphology {
+
+	enum operation_t {
+		DILATE,			// ink where any pixel of the square is ink
+		ERODE,			// ink where every pixel of the square is ink
+		DESPECKLE		// ink where the pixel and at least one of its eight neighbours are ink
+	};
+
+
+	// Loads a row into words, ink as 1, with pixel 0 in the most significant bit of word 0 and every bit
+	// beyond the width clear
+	inline void loadRow(const uint8_t * row, uint32_t width, uint64_t * words) {
+		const uint32_t bytesPerRow = (width + 7) / 8;
+		const uint32_t numWords = (width + 63) / 64;
+		for(uint32_t word = 0; word < numWords; word++) {
+			uint8_t bytes[8];
+			const uint32_t available = (bytesPerRow - (word * 8) < 8) ? bytesPerRow - (word * 8) : 8;
+			memset(bytes, 0xFF, sizeof(bytes));
+			memcpy(bytes, row + ((uint64_t)word * 8), available);
+			uint64_t value = 0;
+			for(int byte = 0; byte < 8; byte++) {
+				value = (value << 8) | bytes[byte];
+			}
+			words[word] = ~value;
+		}
+		if(width % 64 != 0) {
+			words[numWords - 1] &= ~0ull << (64 - (width % 64));
+		}
+	}
+
+
+	// Stores words loaded by loadRow() back into a row of bytes
+	inline void storeRow(const uint64_t * words, uint32_t width, uint8_t * row) {
+		const uint32_t bytesPerRow = (width + 7) / 8;
+		const uint32_t numWords = (width + 63) / 64;
+		for(uint32_t word = 0; word < numWords; word++) {
+			uint64_t value = ~words[word];
+			if(word == numWords - 1 && width % 64 != 0) {
+				value |= ~0ull >> (width % 64);
+			}
+			uint8_t bytes[8];
+			for(int byte = 7; byte >= 0; byte--) {
+				bytes[byte] = (uint8_t)value;
+				value >>= 8;
+			}
+			const uint32_t available = (bytesPerRow - (word * 8) < 8) ? bytesPerRow - (word * 8) : 8;
+			memcpy(row + ((uint64_t)word * 8), bytes, available);
+		}
+	}
+
+
+	// Each pixel of a word replaced by its left or right hand neighbour, carrying across from the adjacent words
+	inline uint64_t leftNeighbours(const uint64_t * words, uint32_t word) {
+		return (words[word] >> 1) | ((word > 0) ? (words[word - 1] << 63) : 0);
+	}
+
+
+	inline uint64_t rightNeighbours(const uint64_t * words, uint32_t word, uint32_t numWords) {
+		return (words[word] << 1) | ((word + 1 < numWords) ? (words[word + 1] >> 63) : 0);
+	}
+
+
+	// Applies one operation to every pixel. Three rows are held as words at a time, and each row of the
+	// image is read before the output row above it is written, so image and filtered may be the same
+	inline void apply(const uint8_t * image, uint32_t width, uint32_t height, operation_t operation, uint8_t * filtered) {
+		if(width == 0 || height == 0) {
+			return;
+		}
+		const uint32_t bytesPerRow = (width + 7) / 8;
+		const uint32_t numWords = (width + 63) / 64;
+		std::vector<uint64_t> window(3 * numWords);
+		const std::vector<uint64_t> background(numWords, 0);
+		std::vector<uint64_t> result(numWords);
+		loadRow(image, width, &window[0]);
+		if(height > 1) {
+			loadRow(image + bytesPerRow, width, &window[numWords]);
+		}
+		for(uint32_t row = 0; row < height; row++) {
+			const uint64_t * above = (row > 0) ? &window[((row - 1) % 3) * numWords] : background.data();
+			const uint64_t * current = &window[(row % 3) * numWords];
+			const uint64_t * below = (row + 1 < height) ? &window[((row + 1) % 3) * numWords] : background.data();
+			for(uint32_t word = 0; word < numWords; word++) {
+				const uint64_t left = leftNeighbours(current, word);
+				const uint64_t right = rightNeighbours(current, word, numWords);
+				const uint64_t leftAbove = leftNeighbours(above, word);
+				const uint64_t rightAbove = rightNeighbours(above, word, numWords);
+				const uint64_t leftBelow = leftNeighbours(below, word);
+				const uint64_t rightBelow = rightNeighbours(below, word, numWords);
+				if(operation == ERODE) {
+					result[word] = leftAbove & above[word] & rightAbove & left & current[word] & right & leftBelow & below[word] & rightBelow;
+				}
+				else {
+					const uint64_t neighbours = leftAbove | above[word] | rightAbove | left | right | leftBelow | below[word] | rightBelow;
+					result[word] = (operation == DILATE) ? (neighbours | current[word]) : (neighbours & current[word]);
+				}
+			}
+			// Dilation spreads ink into the bits beyond the width, which storeRow() sets back to background
+			storeRow(result.data(), width, filtered + ((uint64_t)row * bytesPerRow));
+			if(row + 2 < height) {
+				loadRow(image + ((uint64_t)(row + 2) * bytesPerRow), width, &window[((row + 2) % 3) * numWords]);
+			}
+		}
+	}
+
+
+	inline void dilate(const uint8_t * image, uint32_t width, uint32_t height, uint8_t * dilated) {
+		apply(image, width, height, DILATE, dilated);
+	}
+
+
+	inline void erode(const uint8_t * image, uint32_t width, uint32_t height, uint8_t * eroded) {
+		apply(image, width, height, ERODE, eroded);
+	}
+
+
+	// Erosion then dilation: removes ink that the 3x3 square does not fit inside, such as specks and lines
+	// thinner than three pixels, leaving larger shapes as they were
+	inline void open(const uint8_t * image, uint32_t width, uint32_t height, uint8_t * opened) {
+		apply(image, width, height, ERODE, opened);
+		apply(opened, width, height, DILATE, opened);
+	}
+
+
+	// Dilation then erosion: fills holes and gaps in the ink that the 3x3 square does not fit inside
+	inline void close(const uint8_t * image, uint32_t width, uint32_t height, uint8_t * closed) {
+		apply(image, width, height, DILATE, closed);
+		apply(closed, width, height, ERODE, closed);
+	}
+
+
+	// Removes ink pixels with no ink among their eight neighbours
+	inline void despeckle(const uint8_t * image, uint32_t width, uint32_t height, uint8_t * despeckled) {
+		apply(image, width, height, DESPECKLE, despeckled);
+	}
+
+
+	// Dilates an image into one a pixel larger on every side, (width+2) x (height+2), so that the thickened
+	// ink is not cut off at the edges. image and emboldened must not overlap.
+	inline void embolden(const uint8_t * image, uint32_t width, uint32_t height, uint8_t * emboldened) {
+		const uint32_t bytesPerRow = (width + 7) / 8;
+		const uint32_t grownBytesPerRow = (width + 9) / 8;
+		memset(emboldened, 0xFF, (uint64_t)grownBytesPerRow * (height + 2));
+		for(uint32_t row = 0; row < height; row++) {
+			const uint8_t * source = image + ((uint64_t)row * bytesPerRow);
+			uint8_t * dest = emboldened + ((uint64_t)(row + 1) * grownBytesPerRow);
+			for(uint32_t byte = 0; byte < grownBytesPerRow; byte++) {
+				const uint8_t previous = (byte > 0) ? source[byte - 1] : 0xFF;
+				const uint8_t next = (byte < bytesPerRow) ? source[byte] : 0xFF;
+				dest[byte] = (uint8_t)((previous << 7) | (next >> 1));
+			}
+		}
+		apply(emboldened, width + 2, height + 2, DILATE, emboldened);
+	}
+
+}
+#endif
@@ -0,0 +1,307 @@
+//============================================================================
+// Name			: Near Duplicate Sink (NearDuplicateSink.h)
+// Description 	: Reports pairs of icons of the same size that differ in no more
+//				: than a given number of pixels
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _NEAR_DUPLICATE_SINK_LIB_H
+#define _NEAR_DUPLICATE_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <stdint.h>
+
+#include "IconSink.h"
+
+// Class for finding near duplicate icons. The packed icon data of each icon is its signature and
+// the Hamming distance between two signatures, the number of pixels that differ, is counted with
+// 64 bit popcounts. Only icons of the same dimensions are compared.
+//
+// Rather than comparing every pair, the signatures are split into threshold+1 parts. Two signatures
+// that differ in no more than threshold bits must be identical in at least one part, so each part is
+// indexed in a hash table and only icons sharing a part are compared (multi-index hashing). The bytes
+// that vary between icons are shared out evenly between the parts, and icons sharing a part are only
+// compared if their counts of ink pixels are close enough for them to be near duplicates.
+//
+// The report lists one pair per line as first,second,distance, with the icons' names.
+class NearDuplicateSink : public IconSink {
+
+private:
+	struct sizeGroup {
+		std::vector<uint32_t> icons;
+		std::vector<uint8_t> signatures;		// signatureBytes per icon, one after another
+		uint32_t signatureBytes;
+	};
+
+	// Allowance for an icon's entry in the hash map of one part of the signatures
+	static const uint32_t indexEntryBytes = 64;
+
+	const std::string path;
+	const uint32_t threshold;
+	std::vector<std::string> names;
+	std::map<std::pair<uint32_t, uint32_t>, sizeGroup> groups;	// by width and height
+	uint64_t numComparisons;
+	uint64_t numPairs;
+
+	NearDuplicateSink(const NearDuplicateSink &);
+	NearDuplicateSink & operator=(const NearDuplicateSink &);
+
+	// Number of bits that differ between two signatures
+	static uint32_t distance(const uint8_t * a, const uint8_t * b, uint32_t numBytes) {
+		uint32_t bits = 0;
+		uint32_t byte = 0;
+		for(; byte + sizeof(uint64_t) <= numBytes; byte += sizeof(uint64_t)) {
+			uint64_t wordA = 0;
+			uint64_t wordB = 0;
+			memcpy(&wordA, a + byte, sizeof(uint64_t));
+			memcpy(&wordB, b + byte, sizeof(uint64_t));
+			bits += __builtin_popcountll(wordA ^ wordB);
+		}
+		for(; byte < numBytes; byte++) {
+			bits += __builtin_popcount(a[byte] ^ b[byte]);
+		}
+		return bits;
+	}
+
+
+	static uint64_t hashBytes(const uint8_t * data, uint32_t numBytes) {
+		// 64 bit FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for(uint32_t i = 0; i < numBytes; i++) {
+			hash ^= data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+
+	void comparePair(const sizeGroup & group, uint32_t first, uint32_t second, std::vector<std::pair<uint32_t, uint32_t>> & pairs,
+			std::vector<uint32_t> & distances) {
+		numComparisons++;
+		const uint32_t bits = distance(&group.signatures[(uint64_t)first * group.signatureBytes], &group.signatures[(uint64_t)second * group.signatureBytes], group.signatureBytes);
+		if(bits <= threshold) {
+			pairs.push_back(std::make_pair(group.icons[first], group.icons[second]));
+			distances.push_back(bits);
+		}
+	}
+
+
+	// Number of set bits in a signature. Two signatures differ in at least as many bits as their counts differ
+	static uint32_t bitsSet(const uint8_t * signature, uint32_t numBytes) {
+		uint32_t bits = 0;
+		for(uint32_t byte = 0; byte < numBytes; byte++) {
+			bits += __builtin_popcount(signature[byte]);
+		}
+		return bits;
+	}
+
+
+	// Reorders the bytes of every signature so that each of the numParts parts, taken one after another, holds
+	// an even share of the bytes that vary between icons. Bytes that are background in most icons, such as the
+	// padding of --samesize icons, would otherwise make whole parts alike and put most icons in one bucket.
+	// Any split into threshold+1 parts finds every pair, and the distance does not depend on the order of the bytes
+	static void spreadVaryingBytes(sizeGroup & group, uint32_t numParts) {
+		const uint32_t numIcons = group.icons.size();
+		const uint32_t numBytes = group.signatureBytes;
+		// How many icons differ from the first at each byte
+		std::vector<uint32_t> differing(numBytes, 0);
+		for(uint32_t icon = 1; icon < numIcons; icon++) {
+			const uint8_t * signature = &group.signatures[(uint64_t)icon * numBytes];
+			for(uint32_t byte = 0; byte < numBytes; byte++) {
+				differing[byte] += (signature[byte] != group.signatures[byte]) ? 1 : 0;
+			}
+		}
+		std::vector<uint32_t> byDiffering(numBytes);
+		for(uint32_t byte = 0; byte < numBytes; byte++) {
+			byDiffering[byte] = byte;
+		}
+		std::stable_sort(byDiffering.begin(), byDiffering.end(), [&differing](uint32_t a, uint32_t b) { return differing[a] > differing[b]; });
+		// The bytes are dealt to the parts back and forth, most varying first, and each part keeps its own bytes together
+		std::vector<std::vector<uint32_t>> partBytes(numParts);
+		for(uint32_t i = 0; i < numBytes; i++) {
+			const uint32_t round = i / numParts;
+			const uint32_t part = (round % 2 == 0) ? (i % numParts) : (numParts - 1 - (i % numParts));
+			partBytes[part].push_back(byDiffering[i]);
+		}
+		std::vector<uint32_t> order;
+		order.reserve(numBytes);
+		for(uint32_t part = 0; part < numParts; part++) {
+			order.insert(order.end(), partBytes[part].begin(), partBytes[part].end());
+		}
+		std::vector<uint8_t> reordered(numBytes);
+		for(uint32_t icon = 0; icon < numIcons; icon++) {
+			uint8_t * signature = &group.signatures[(uint64_t)icon * numBytes];
+			for(uint32_t byte = 0; byte < numBytes; byte++) {
+				reordered[byte] = signature[order[byte]];
+			}
+			memcpy(signature, &reordered[0], numBytes);
+		}
+	}
+
+
+	// Finds the pairs within a group of icons of the same size that are within the threshold
+	void findPairs(sizeGroup & group, std::vector<std::pair<uint32_t, uint32_t>> & pairs, std::vector<uint32_t> & distances) {
+		const uint32_t numIcons = group.icons.size();
+		const uint32_t numParts = threshold + 1;
+		// Signatures too short to split into enough parts, and small groups, are compared pair by pair
+		if(group.signatureBytes < numParts || numIcons < 32) {
+			for(uint32_t first = 0; first < numIcons; first++) {
+				for(uint32_t second = first + 1; second < numIcons; second++) {
+					comparePair(group, first, second, pairs, distances);
+				}
+			}
+			return;
+		}
+		spreadVaryingBytes(group, numParts);
+		// The parts are the same size, to within a byte, as the bytes were dealt to them in turn
+		std::vector<uint32_t> partStart(numParts + 1);
+		for(uint32_t part = 0; part <= numParts; part++) {
+			partStart[part] = ((uint64_t)group.signatureBytes * part) / numParts;
+		}
+		std::vector<uint32_t> inkCounts(numIcons);
+		for(uint32_t icon = 0; icon < numIcons; icon++) {
+			inkCounts[icon] = bitsSet(&group.signatures[(uint64_t)icon * group.signatureBytes], group.signatureBytes);
+		}
+		for(uint32_t part = 0; part < numParts; part++) {
+			const uint32_t partBytes = partStart[part + 1] - partStart[part];
+			std::unordered_map<uint64_t, std::vector<uint32_t>> index;
+			for(uint32_t icon = 0; icon < numIcons; icon++) {
+				index[hashBytes(&group.signatures[((uint64_t)icon * group.signatureBytes) + partStart[part]], partBytes)].push_back(icon);
+			}
+			for(std::unordered_map<uint64_t, std::vector<uint32_t>>::iterator bucket = index.begin(); bucket != index.end(); bucket++) {
+				// Within a bucket only icons whose counts of set bits are within the threshold of each other can be
+				// near duplicates, so the members are taken in order of that count and each is compared with those
+				// that follow it until the counts are too far apart
+				std::vector<uint32_t> & members = bucket->second;
+				std::stable_sort(members.begin(), members.end(), [&inkCounts](uint32_t a, uint32_t b) { return inkCounts[a] < inkCounts[b]; });
+				for(uint32_t i = 0; i < members.size(); i++) {
+					const uint8_t * first = &group.signatures[(uint64_t)members[i] * group.signatureBytes];
+					for(uint32_t j = i + 1; j < members.size() && inkCounts[members[j]] - inkCounts[members[i]] <= threshold; j++) {
+						const uint8_t * second = &group.signatures[(uint64_t)members[j] * group.signatureBytes];
+						// Each pair is compared once, at the first part in which the two are identical
+						if(memcmp(first + partStart[part], second + partStart[part], partBytes) != 0) {
+							continue;
+						}
+						bool earlierPartIdentical = false;
+						for(uint32_t earlier = 0; earlier < part && !earlierPartIdentical; earlier++) {
+							earlierPartIdentical = (memcmp(first + partStart[earlier], second + partStart[earlier], partStart[earlier + 1] - partStart[earlier]) == 0);
+						}
+						if(!earlierPartIdentical) {
+							comparePair(group, std::min(members[i], members[j]), std::max(members[i], members[j]), pairs, distances);
+						}
+					}
+				}
+			}
+		}
+	}
+
+public:
+	// Constructor. Pairs of icons differing in threshold pixels or fewer are reported
+	NearDuplicateSink(const std::string & reportPath, uint32_t maximumDistance) : path(reportPath), threshold(maximumDistance),
+		numComparisons(0), numPairs(0) {
+		//
+	}
+
+
+	// Each group's signatures are reserved, so that they are never copied as they grow
+	bool begin(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) {
+		names.resize(iconWidths.size());
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> groupSizes;
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			groupSizes[std::make_pair(iconWidths[i], iconHeights[i])]++;
+		}
+		for(std::map<std::pair<uint32_t, uint32_t>, uint32_t>::iterator it = groupSizes.begin(); it != groupSizes.end(); it++) {
+			sizeGroup & group = groups[it->first];
+			group.signatureBytes = ((it->first.first + 7) / 8) * it->first.second;
+			group.icons.reserve(it->second);
+			group.signatures.reserve((uint64_t)it->second * group.signatureBytes);
+		}
+		return true;
+	}
+
+
+	bool writeIcon(uint32_t icon, const std::string & name, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		sizeGroup & group = groups[std::make_pair(iconWidth, iconHeight)];
+		group.signatureBytes = ((iconWidth + 7) / 8) * iconHeight;
+		group.icons.push_back(icon);
+		group.signatures.insert(group.signatures.end(), iconData, iconData + group.signatureBytes);
+		names[icon] = name;
+		return true;
+	}
+
+
+	bool finish() {
+		std::vector<std::pair<uint32_t, uint32_t>> pairs;
+		std::vector<uint32_t> distances;
+		for(std::map<std::pair<uint32_t, uint32_t>, sizeGroup>::iterator it = groups.begin(); it != groups.end(); it++) {
+			findPairs(it->second, pairs, distances);
+		}
+		// Report the pairs in icon order
+		std::vector<uint32_t> order(pairs.size());
+		for(uint32_t i = 0; i < order.size(); i++) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&pairs](uint32_t a, uint32_t b) { return pairs[a] < pairs[b]; });
+		std::ofstream report(path.c_str(), (std::ofstream::out | std::ofstream::trunc));
+		report << "first,second,distance\n";
+		for(uint32_t i = 0; i < order.size(); i++) {
+			report << names[pairs[order[i]].first] << ',' << names[pairs[order[i]].second] << ',' << distances[order[i]] << '\n';
+		}
+		report.close();
+		numPairs = pairs.size();
+		return !report.fail();
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return "signature of icon " + name + " for " + path;
+	}
+
+
+	// Every icon's signature and name, and its entry in the index of one part of the signatures. The pairs
+	// found are not counted, as how many there are depends on how alike the icons are
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		uint64_t numBytes = 0;
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			numBytes += ((uint64_t)((iconWidths[i] + 7) / 8) * iconHeights[i]) + sizeof(uint32_t) + sizeof(std::string) + indexEntryBytes;
+		}
+		return numBytes;
+	}
+
+
+	uint64_t comparisons() const {
+		return numComparisons;
+	}
+
+
+	uint64_t pairsFound() const {
+		return numPairs;
+	}
+
+};
+#endif
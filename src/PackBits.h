@@ -0,0 +1,103 @@
+//============================================================================
+// Name			: PackBits (PackBits.h)
+// Description 	: PackBits run length encoding and decoding of byte strings, as
+//				: used for the compressed icon output
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _PACK_BITS_LIB_H
+#define _PACK_BITS_LIB_H
+
+#include <vector>
+#include <stdint.h>
+
+// PackBits stores a byte string as a series of packets, each starting with a header byte n:
+//   0 to 127      the next n+1 bytes are copied as they are
+//   129 to 255    the next byte is repeated 257-n times
+//   128           no operation
+// Icon rows are mostly white, so they shrink to a few repeat packets.
+namespace PackBits {
+
+	// Appends the encoding of numBytes bytes of source to encoded
+	inline void encode(const uint8_t * source, uint32_t numBytes, std::vector<uint8_t> & encoded) {
+		uint32_t i = 0;
+		while(i < numBytes) {
+			uint32_t run = 1;
+			while(i + run < numBytes && run < 128 && source[i + run] == source[i]) {
+				run++;
+			}
+			if(run >= 3) {
+				encoded.push_back((uint8_t)(257 - run));
+				encoded.push_back(source[i]);
+				i += run;
+				continue;
+			}
+			// Copy bytes literally until a run of three or more begins
+			uint32_t literal = 0;
+			while(i + literal < numBytes && literal < 128) {
+				if(i + literal + 2 < numBytes && source[i + literal] == source[i + literal + 1] && source[i + literal] == source[i + literal + 2]) {
+					break;
+				}
+				literal++;
+			}
+			encoded.push_back((uint8_t)(literal - 1));
+			encoded.insert(encoded.end(), source + i, source + i + literal);
+			i += literal;
+		}
+	}
+
+
+	// Decodes exactly numBytes bytes into destination. Returns the number of encoded bytes used,
+	// or 0 if the encoding is corrupt or would run past the end of either buffer.
+	// Only needs stdint.h, so it can be copied as it is into firmware.
+	inline uint32_t decode(const uint8_t * encoded, uint32_t encodedBytes, uint8_t * destination, uint32_t numBytes) {
+		uint32_t in = 0;
+		uint32_t out = 0;
+		while(out < numBytes) {
+			if(in >= encodedBytes) {
+				return 0;
+			}
+			const uint8_t header = encoded[in++];
+			if(header < 128) {
+				const uint32_t count = (uint32_t)header + 1;
+				if(in + count > encodedBytes || out + count > numBytes) {
+					return 0;
+				}
+				for(uint32_t i = 0; i < count; i++) {
+					destination[out++] = encoded[in++];
+				}
+			}
+			else if(header > 128) {
+				const uint32_t count = 257 - (uint32_t)header;
+				if(in >= encodedBytes || out + count > numBytes) {
+					return 0;
+				}
+				const uint8_t value = encoded[in++];
+				for(uint32_t i = 0; i < count; i++) {
+					destination[out++] = value;
+				}
+			}
+		}
+		return in;
+	}
+
+}
+#endif
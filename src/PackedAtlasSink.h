@@ -0,0 +1,163 @@
+//============================================================================
+// Name			: Packed Atlas Sink (PackedAtlasSink.h)
+// Description 	: Repacks every icon into one small bitmap, without the gutters
+//				: of the input sheet, and writes a table of icon coordinates
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _PACKED_ATLAS_SINK_LIB_H
+#define _PACKED_ATLAS_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <stdint.h>
+
+#include "IconSink.h"
+#include "BmpHeader.h"
+#include "SkylinePacker.h"
+
+// Class for repacking every icon into one one-bit-per-pixel bitmap. The positions are worked out
+// from the icon dimensions before any icon is extracted, so each icon is copied into the atlas as
+// it arrives. The bitmap is written to the target file and the coordinates of every icon, as
+//   name,x,y,width,height
+// to the same path with ".csv" appended.
+class PackedAtlasSink : public IconSink {
+
+private:
+	const std::string path;
+	const uint32_t darkColour;
+	const uint32_t lightColour;
+	SkylinePacker packer;
+	std::vector<uint8_t> atlas;			// normalised rows, top to bottom
+	uint32_t bytesInAtlasRow;
+	std::ofstream coordinates;
+	std::chrono::steady_clock::duration timePacking;
+
+	PackedAtlasSink(const PackedAtlasSink &);
+	PackedAtlasSink & operator=(const PackedAtlasSink &);
+
+	// Copies numBits bits from the start of source to bit position firstBit of destination,
+	// most significant bit first, leaving the destination bits either side untouched
+	static void copyBits(uint8_t * destination, uint32_t firstBit, const uint8_t * source, uint32_t numBits) {
+		destination += firstBit / 8;
+		const unsigned int shift = firstBit % 8;
+		const uint32_t numBytes = (numBits + 7) / 8;
+		if(shift == 0 && numBits % 8 == 0) {
+			memcpy(destination, source, numBytes);
+			return;
+		}
+		for(uint32_t byte = 0; byte < numBytes; byte++) {
+			const unsigned int bitsInByte = (byte + 1 < numBytes || numBits % 8 == 0) ? 8 : numBits % 8;
+			const uint8_t mask = 0xFF << (8 - bitsInByte);
+			const uint8_t bits = source[byte] & mask;
+			destination[byte] = (destination[byte] & ~(mask >> shift)) | (bits >> shift);
+			const uint8_t spill = (uint8_t)(mask << (8 - shift));
+			if(shift != 0 && spill != 0) {
+				destination[byte + 1] = (destination[byte + 1] & ~spill) | (uint8_t)(bits << (8 - shift));
+			}
+		}
+	}
+
+public:
+	// Constructor. With byteAligned every icon starts on a byte boundary, so it can be drawn from the atlas without bit shifts
+	PackedAtlasSink(const std::string & atlasPath, uint32_t dark, uint32_t light, bool byteAligned) : path(atlasPath),
+		darkColour(dark), lightColour(light), packer(byteAligned ? 8 : 1), bytesInAtlasRow(0), timePacking(0) {
+		//
+	}
+
+
+	bool begin(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) {
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		packer.pack(iconWidths, iconHeights);
+		timePacking = std::chrono::steady_clock::now() - start;
+		// Unused parts of the atlas are white
+		bytesInAtlasRow = (std::max(packer.width(), 1u) + 7) / 8;
+		atlas.assign((uint64_t)bytesInAtlasRow * std::max(packer.height(), 1u), 0xFF);
+		coordinates.open((path + ".csv").c_str(), (std::ofstream::out | std::ofstream::trunc));
+		coordinates << "name,x,y,width,height\n";
+		return !coordinates.fail();
+	}
+
+
+	bool writeIcon(uint32_t icon, const std::string & name, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		const uint32_t bytesInIconRow = (iconWidth + 7) / 8;
+		for(uint32_t row = 0; row < iconHeight; row++) {
+			copyBits(&atlas[(uint64_t)(packer.y(icon) + row) * bytesInAtlasRow], packer.x(icon), iconData + ((uint64_t)row * bytesInIconRow), iconWidth);
+		}
+		coordinates << name << ',' << packer.x(icon) << ',' << packer.y(icon) << ',' << iconWidth << ',' << iconHeight << '\n';
+		return !coordinates.fail();
+	}
+
+
+	bool finish() {
+		coordinates.close();
+		const uint32_t atlasWidth = std::max(packer.width(), 1u);
+		const uint32_t atlasHeight = std::max(packer.height(), 1u);
+		const uint32_t bytesInFileRow = ((bytesInAtlasRow + 3) / 4) * 4;
+		std::vector<char> headers(BmpHeader::canonicalSize);
+		BmpHeader::writeCanonical(&headers[0], atlasWidth, atlasHeight, bytesInFileRow * atlasHeight, darkColour, lightColour);
+		std::ofstream bitmap(path.c_str(), (std::ofstream::out | std::ofstream::binary | std::ofstream::trunc));
+		bitmap.write(&headers[0], headers.size());
+		// Bitmap files store the rows from bottom to top, each padded to a multiple of 4 bytes
+		const std::vector<char> padding(bytesInFileRow - bytesInAtlasRow, (char)0xFF);
+		for(uint32_t row = atlasHeight; row > 0; row--) {
+			bitmap.write((const char *)&atlas[(uint64_t)(row - 1) * bytesInAtlasRow], bytesInAtlasRow);
+			bitmap.write(padding.data(), padding.size());
+		}
+		bitmap.close();
+		return !bitmap.fail() && !coordinates.fail();
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return "icon " + name + " of " + path;
+	}
+
+
+	// The atlas and every icon's position in it. The icons are packed here as they will be in begin(), to find
+	// the size of the atlas
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		SkylinePacker trialPacker(packer);
+		trialPacker.pack(iconWidths, iconHeights);
+		return ((uint64_t)((std::max(trialPacker.width(), 1u) + 7) / 8) * std::max(trialPacker.height(), 1u)) +
+				((uint64_t)iconWidths.size() * 2 * sizeof(uint32_t));
+	}
+
+
+	uint32_t width() const {
+		return packer.width();
+	}
+
+
+	uint32_t height() const {
+		return packer.height();
+	}
+
+
+	uint64_t millisecondsPacking() const {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(timePacking).count();
+	}
+
+};
+#endif
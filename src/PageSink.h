@@ -0,0 +1,75 @@
+//============================================================================
+// Name			: Page Sink (PageSink.h)
+// Description 	: Writes every icon in the vertical page layout of SSD1306 and
+//				: SH1106 style OLED controllers
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _PAGE_SINK_LIB_H
+#define _PAGE_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "BlobSink.h"
+#include "BitKernels.h"
+
+// Class for writing icons as pages of vertical bytes, the layout of SSD1306 display memory, so that an
+// icon can be copied straight into a frame buffer. Each block is ceil(height/8) pages from top to bottom,
+// each page width bytes from left to right. Bit 0 of a byte is the top pixel of the page's eight rows and
+// bit 7 the bottom. A set bit is a lit pixel, which is ink (black in the bit map). Rows below the bottom
+// of the icon are unlit. The file identifier is "IPAG".
+class PageSink : public BlobSink {
+
+protected:
+	bool encode(const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		const uint32_t bytesPerRow = (iconWidth + 7) / 8;
+		const uint32_t numPages = (iconHeight + 7) / 8;
+		blocks.resize(blocks.size() + ((uint64_t)numPages * iconWidth));
+		uint8_t * page = &blocks[blocks.size() - ((uint64_t)numPages * iconWidth)];
+		for(uint32_t pageNum = 0; pageNum < numPages; pageNum++, page += iconWidth) {
+			for(uint32_t byteColumn = 0; byteColumn < bytesPerRow; byteColumn++) {
+				// Gathering the page's rows bottom first and transposing leaves each column of eight pixels
+				// in one byte with the top pixel in bit 0. Inverting it makes ink, and nothing else, lit.
+				const uint64_t tile = ~BitKernels::transpose8(BitKernels::gatherTile(iconData, bytesPerRow, iconHeight,
+						(8 * (int64_t)pageNum) + 7, -1, byteColumn));
+				for(uint32_t i = 0; i < 8 && (8 * byteColumn) + i < iconWidth; i++) {
+					page[(8 * byteColumn) + i] = (uint8_t)(tile >> (8 * (7 - i)));
+				}
+			}
+		}
+		return true;
+	}
+
+
+	uint64_t maxBlockBytes(uint32_t iconWidth, uint32_t iconHeight) const {
+		return (uint64_t)((iconHeight + 7) / 8) * iconWidth;
+	}
+
+public:
+	// Constructor
+	PageSink(const std::string & blobPath) : BlobSink(blobPath, "IPAG", 1) {
+		//
+	}
+
+};
+#endif
@@ -0,0 +1,128 @@
+//============================================================================
+// Name			: Pixel Format Sink (PixelFormatSink.h)
+// Description 	: Writes every icon expanded to whole bytes per pixel, as 8 bit
+//				: alpha, RGB565 or RGBA8888, for colour displays and simulators
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _PIXEL_FORMAT_SINK_LIB_H
+#define _PIXEL_FORMAT_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+
+#include "BlobSink.h"
+
+// Class for writing icons with each pixel expanded to one, two or four bytes. Each block is the icon's
+// pixels, rows from top to bottom with no padding, in one of the formats:
+//   A8        "IA8 "  one byte of coverage, 0xFF for ink and 0x00 for the background
+//   RGB565    "I565"  uint16 little endian, red in the top five bits, blue in the bottom five
+//   RGBA8888  "IRGA"  four bytes in the order red, green, blue, alpha
+// Ink takes the foreground colour and the background the background colour. Colours are given as
+// 0xRRGGBBAA; A8 ignores them.
+class PixelFormatSink : public BlobSink {
+
+public:
+	// Enumerator for the pixel formats
+	enum pixelFormat_t {A8, RGB565, RGBA8888};
+
+private:
+	const uint32_t bytesPerPixel;
+	// For every value of a byte of icon data, the eight pixels it expands to
+	std::vector<uint8_t> expansions;
+
+	static const char * identifier(pixelFormat_t format) {
+		return (format == A8) ? "IA8 " : ((format == RGB565) ? "I565" : "IRGA");
+	}
+
+
+	// Writes one pixel of the given colour in the given format
+	static void writePixel(pixelFormat_t format, uint32_t colour, bool ink, uint8_t * pixel) {
+		const uint8_t red = colour >> 24;
+		const uint8_t green = colour >> 16;
+		const uint8_t blue = colour >> 8;
+		const uint8_t alpha = colour;
+		if(format == A8) {
+			pixel[0] = ink ? 0xFF : 0x00;
+		}
+		else if(format == RGB565) {
+			const uint16_t value = ((red >> 3) << 11) | ((green >> 2) << 5) | (blue >> 3);
+			pixel[0] = value & 0xFF;
+			pixel[1] = value >> 8;
+		}
+		else {
+			pixel[0] = red;
+			pixel[1] = green;
+			pixel[2] = blue;
+			pixel[3] = alpha;
+		}
+	}
+
+protected:
+	// Each byte of icon data is expanded to eight pixels by copying them from the table, a byte of
+	// input and 8, 16 or 32 bytes of output at a time. The last byte of each row only supplies the
+	// pixels before the padding.
+	bool encode(const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		const uint32_t bytesPerRow = (iconWidth + 7) / 8;
+		const uint32_t bytesPerExpansion = 8 * bytesPerPixel;
+		const uint64_t blockStart = blocks.size();
+		blocks.resize(blockStart + ((uint64_t)iconWidth * iconHeight * bytesPerPixel));
+		uint8_t * pixels = &blocks[blockStart];
+		for(uint32_t row = 0; row < iconHeight; row++) {
+			const uint8_t * source = iconData + ((uint64_t)row * bytesPerRow);
+			for(uint32_t byte = 0; byte + 1 < bytesPerRow; byte++, pixels += bytesPerExpansion) {
+				memcpy(pixels, &expansions[source[byte] * bytesPerExpansion], bytesPerExpansion);
+			}
+			const uint32_t pixelsInLastByte = iconWidth - (8 * (bytesPerRow - 1));
+			memcpy(pixels, &expansions[source[bytesPerRow - 1] * bytesPerExpansion], pixelsInLastByte * bytesPerPixel);
+			pixels += pixelsInLastByte * bytesPerPixel;
+		}
+		return true;
+	}
+
+
+	uint64_t maxBlockBytes(uint32_t iconWidth, uint32_t iconHeight) const {
+		return (uint64_t)iconWidth * iconHeight * bytesPerPixel;
+	}
+
+public:
+	// Constructor. Colours are 0xRRGGBBAA
+	PixelFormatSink(const std::string & blobPath, pixelFormat_t format, uint32_t foreground, uint32_t background) :
+		BlobSink(blobPath, identifier(format), 1), bytesPerPixel((format == A8) ? 1 : ((format == RGB565) ? 2 : 4)) {
+		expansions.resize(256 * 8 * bytesPerPixel);
+		for(uint32_t value = 0; value < 256; value++) {
+			for(uint32_t bit = 0; bit < 8; bit++) {
+				// Pixel data is most significant bit first, with 0 for ink
+				const bool ink = ((value >> (7 - bit)) & 1) == 0;
+				writePixel(format, (ink ? foreground : background), ink, &expansions[((value * 8) + bit) * bytesPerPixel]);
+			}
+		}
+	}
+
+
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		return BlobSink::bytesRetained(iconWidths, iconHeights) + expansions.size();
+	}
+
+};
+#endif
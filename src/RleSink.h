@@ -0,0 +1,140 @@
+//============================================================================
+// Name			: RLE Sink (RleSink.h)
+// Description 	: Writes every icon into one indexed file, with each row of the
+//				: icon compressed by PackBits run length encoding
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _RLE_SINK_LIB_H
+#define _RLE_SINK_LIB_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <stdint.h>
+
+#include "BlobSink.h"
+#include "Crc32c.h"
+#include "PackBits.h"
+
+// Class for writing icons compressed with PackBits. Each block is the encoding of the icon's rows,
+// top to bottom, ceil(width/8) bytes per row. The rows are encoded as one string rather than one at
+// a time, as the rows of small icons are only a few bytes long and runs of white continue from one
+// row into the next. The file identifier is "IRLE".
+class RleSink : public BlobSink {
+
+private:
+	const bool verifying;
+	std::vector<uint32_t> checksums;		// CRC-32C of each icon before encoding, when verifying
+	uint64_t uncompressedBytes;
+	std::chrono::steady_clock::duration timeDecoding;
+
+protected:
+	bool encode(const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		const uint32_t iconArraySize = ((iconWidth + 7) / 8) * iconHeight;
+		PackBits::encode(iconData, iconArraySize, blocks);
+		uncompressedBytes += iconArraySize;
+		return true;
+	}
+
+
+	// Literal runs of up to 128 bytes cost one byte more, and repeated runs less
+	uint64_t maxBlockBytes(uint32_t iconWidth, uint32_t iconHeight) const {
+		const uint64_t iconArraySize = (uint64_t)((iconWidth + 7) / 8) * iconHeight;
+		return iconArraySize + ((iconArraySize + 127) / 128);
+	}
+
+public:
+	// Constructor. When verifying, finish() decodes every icon again, timing the decoder and checking
+	// that each icon decodes to the bytes it was encoded from
+	RleSink(const std::string & blobPath, bool verifyDecoding) : BlobSink(blobPath, "IRLE", 1), verifying(verifyDecoding),
+		uncompressedBytes(0), timeDecoding(0) {
+		//
+	}
+
+
+	// Decodes one icon from its block into iconData, ceil(width/8) bytes per row. Returns false if the block is corrupt
+	static bool decodeIcon(const uint8_t * block, uint64_t blockLength, uint32_t iconWidth, uint32_t iconHeight, uint8_t * iconData) {
+		const uint32_t iconArraySize = ((iconWidth + 7) / 8) * iconHeight;
+		return PackBits::decode(block, blockLength, iconData, iconArraySize) == blockLength;
+	}
+
+
+	bool begin(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) {
+		if(verifying) {
+			checksums.assign(iconWidths.size(), 0);
+		}
+		return BlobSink::begin(iconWidths, iconHeights);
+	}
+
+
+	bool writeIcon(uint32_t icon, const std::string & name, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		if(verifying) {
+			checksums[icon] = Crc32c::compute(iconData, ((iconWidth + 7) / 8) * iconHeight);
+		}
+		return BlobSink::writeIcon(icon, name, iconData, iconWidth, iconHeight);
+	}
+
+
+	// When verifying, fails if any icon does not decode to the bytes it was encoded from. Only the decoder is timed
+	bool finish() {
+		if(verifying) {
+			std::vector<uint8_t> iconData;
+			timeDecoding = std::chrono::steady_clock::duration(0);
+			for(uint32_t icon = 0; icon < numIcons(); icon++) {
+				iconData.resize((uint64_t)((width(icon) + 7) / 8) * height(icon));
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				const bool decoded = decodeIcon(block(icon), blockLength(icon), width(icon), height(icon), iconData.data());
+				timeDecoding += std::chrono::steady_clock::now() - start;
+				if(!decoded || Crc32c::compute(iconData.data(), iconData.size()) != checksums[icon]) {
+					return false;
+				}
+			}
+		}
+		return BlobSink::finish();
+	}
+
+
+	// When verifying, the checksum of every icon is kept and one icon at a time is decoded again
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		uint64_t largestIconBytes = 0;
+		for(uint32_t i = 0; i < iconWidths.size() && verifying; i++) {
+			largestIconBytes = std::max(largestIconBytes, (uint64_t)((iconWidths[i] + 7) / 8) * iconHeights[i]);
+		}
+		return BlobSink::bytesRetained(iconWidths, iconHeights) + (verifying ? iconWidths.size() * sizeof(uint32_t) : 0) + largestIconBytes;
+	}
+
+
+	// Number of bytes the icons would take up without compression
+	uint64_t sizeUncompressed() const {
+		return uncompressedBytes;
+	}
+
+
+	// Time taken by the decoder to decode every icon when verifying, in microseconds
+	uint64_t microsecondsDecoding() const {
+		return std::chrono::duration_cast<std::chrono::microseconds>(timeDecoding).count();
+	}
+
+};
+#endif
@@ -0,0 +1,244 @@
+//============================================================================
+// Name			: Row Dictionary Sink (RowDictionarySink.h)
+// Description 	: Writes every icon into one file as a list of references to
+//				: a shared dictionary of the distinct rows found in all icons
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _ROW_DICTIONARY_SINK_LIB_H
+#define _ROW_DICTIONARY_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <fstream>
+#include <cstring>
+#include <stdint.h>
+
+#include "IconSink.h"
+
+// Class for writing a row dictionary file. Glyphs of a font share many identical rows (blank rows,
+// stems, serifs), so each distinct row is stored once, in a table of rows of the same length, and
+// every icon becomes a list of row numbers within its table.
+//
+// File layout, all values little endian:
+//   Header, 16 bytes:          "IRDX", uint32 version, uint32 number of icons, uint32 number of tables
+//   Tables, 16 bytes each:     uint32 bytes per row, uint32 number of rows, uint64 offset of the rows
+//   Index, 16 bytes per icon:  uint32 offset of the icon's row numbers, uint32 table, uint32 width, uint32 height
+//   Row numbers:               for each icon, one per row from top to bottom. uint16 if the icon's table
+//                              holds no more than 65536 rows, otherwise uint32
+//   Rows:                      the rows of each table in turn, most significant bit first, 0 for black
+// Row r of icon i is then found directly at rows offset + (bytes per row * row number r), without
+// decoding any other row.
+class RowDictionarySink : public IconSink {
+
+private:
+	struct rowTable {
+		uint32_t bytesPerRow;
+		std::vector<uint8_t> rows;
+		std::unordered_map<std::string, uint32_t> rowNumbers;
+	};
+
+	const std::string path;
+	std::map<uint32_t, rowTable> tables;		// by bytes per row
+	std::vector<uint32_t> iconTables;			// bytes per row of each icon's table
+	std::vector<uint32_t> widths;
+	std::vector<uint32_t> heights;
+	std::vector<uint64_t> firstRowNumber;		// position of each icon's first row number in rowNumbers
+	std::vector<uint32_t> rowNumbers;
+	uint64_t iconRows;
+
+	RowDictionarySink(const RowDictionarySink &);
+	RowDictionarySink & operator=(const RowDictionarySink &);
+
+	// Counts the rows of the icons that go in each table, by bytes per row. Returns the number of rows in all of them
+	static uint64_t rowsInTables(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights, std::map<uint32_t, uint64_t> & tableRows) {
+		uint64_t numRows = 0;
+		for(uint32_t i = 0; i < iconWidths.size(); i++) {
+			tableRows[(iconWidths[i] + 7) / 8] += iconHeights[i];
+			numRows += iconHeights[i];
+		}
+		return numRows;
+	}
+
+
+	// Most distinct rows there can be among numRows rows of bytesPerRow bytes
+	static uint64_t maxDistinctRows(uint32_t bytesPerRow, uint64_t numRows) {
+		return (bytesPerRow < 4) ? std::min<uint64_t>(numRows, (uint64_t)1 << (8 * bytesPerRow)) : numRows;
+	}
+
+public:
+	static const uint32_t headerSize = 16;
+	static const uint32_t tableEntrySize = 16;
+	static const uint32_t indexEntrySize = 16;
+	static const uint32_t version = 1;
+	// Allowance for a distinct row's node and bucket in its table's hash map
+	static const uint32_t rowEntryBytes = 64;
+
+	// Constructor
+	RowDictionarySink(const std::string & dictionaryPath) : path(dictionaryPath), iconRows(0) {
+		//
+	}
+
+
+	bool begin(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) {
+		widths = iconWidths;
+		heights = iconHeights;
+		iconTables.assign(iconWidths.size(), 0);
+		firstRowNumber.assign(iconWidths.size(), 0);
+		// Reserved for as many distinct rows as there can be, so that no table is copied as it grows
+		std::map<uint32_t, uint64_t> tableRows;
+		const uint64_t numRows = rowsInTables(iconWidths, iconHeights, tableRows);
+		for(std::map<uint32_t, uint64_t>::iterator it = tableRows.begin(); it != tableRows.end(); it++) {
+			tables[it->first].bytesPerRow = it->first;
+			tables[it->first].rows.reserve(maxDistinctRows(it->first, it->second) * it->first);
+		}
+		rowNumbers.reserve(numRows);
+		return true;
+	}
+
+
+	// Looks up each row of the icon in the dictionary, adding the rows not seen before
+	bool writeIcon(uint32_t icon, const std::string & /*name*/, const uint8_t * iconData, uint32_t iconWidth, uint32_t iconHeight) {
+		const uint32_t bytesInIconRow = (iconWidth + 7) / 8;
+		rowTable & table = tables[bytesInIconRow];
+		table.bytesPerRow = bytesInIconRow;
+		iconTables[icon] = bytesInIconRow;
+		firstRowNumber[icon] = rowNumbers.size();
+		std::string row;
+		for(uint32_t r = 0; r < iconHeight; r++) {
+			const uint8_t * rowData = iconData + ((uint64_t)r * bytesInIconRow);
+			row.assign((const char *)rowData, bytesInIconRow);
+			std::unordered_map<std::string, uint32_t>::iterator found = table.rowNumbers.find(row);
+			if(found == table.rowNumbers.end()) {
+				found = table.rowNumbers.insert(std::make_pair(row, (uint32_t)table.rowNumbers.size())).first;
+				table.rows.insert(table.rows.end(), rowData, rowData + bytesInIconRow);
+			}
+			rowNumbers.push_back(found->second);
+		}
+		iconRows += iconHeight;
+		return true;
+	}
+
+
+	bool finish() {
+		const uint32_t numIcons = widths.size();
+		const uint32_t numTables = tables.size();
+		std::vector<char> file(headerSize + ((uint64_t)numTables * tableEntrySize) + ((uint64_t)numIcons * indexEntrySize));
+		uint64_t fileSize = file.size();
+		for(uint32_t icon = 0; icon < numIcons; icon++) {
+			fileSize += (uint64_t)heights[icon] * ((tables[iconTables[icon]].rowNumbers.size() <= 65536) ? sizeof(uint16_t) : sizeof(uint32_t));
+		}
+		for(std::map<uint32_t, rowTable>::const_iterator it = tables.begin(); it != tables.end(); it++) {
+			fileSize += it->second.rows.size();
+		}
+		file.reserve(fileSize);
+		memcpy(&file[0], "IRDX", 4);
+		memcpy(&file[4], &version, sizeof(uint32_t));
+		memcpy(&file[8], &numIcons, sizeof(uint32_t));
+		memcpy(&file[12], &numTables, sizeof(uint32_t));
+
+		// Row numbers of every icon
+		std::map<uint32_t, uint32_t> tableNumbers;
+		uint32_t table = 0;
+		for(std::map<uint32_t, rowTable>::iterator it = tables.begin(); it != tables.end(); it++, table++) {
+			tableNumbers[it->first] = table;
+		}
+		for(uint32_t icon = 0; icon < numIcons; icon++) {
+			const uint32_t offset = file.size();
+			table = tableNumbers[iconTables[icon]];
+			char * entry = &file[headerSize + ((uint64_t)numTables * tableEntrySize) + ((uint64_t)icon * indexEntrySize)];
+			memcpy(entry, &offset, sizeof(uint32_t));
+			memcpy(entry + 4, &table, sizeof(uint32_t));
+			memcpy(entry + 8, &widths[icon], sizeof(uint32_t));
+			memcpy(entry + 12, &heights[icon], sizeof(uint32_t));
+			const bool shortNumbers = tables[iconTables[icon]].rowNumbers.size() <= 65536;
+			for(uint32_t r = 0; r < heights[icon]; r++) {
+				const uint32_t number = rowNumbers[firstRowNumber[icon] + r];
+				if(shortNumbers) {
+					const uint16_t shortNumber = number;
+					file.insert(file.end(), (const char *)&shortNumber, (const char *)&shortNumber + sizeof(uint16_t));
+				}
+				else {
+					file.insert(file.end(), (const char *)&number, (const char *)&number + sizeof(uint32_t));
+				}
+			}
+		}
+
+		// The tables of distinct rows
+		table = 0;
+		for(std::map<uint32_t, rowTable>::iterator it = tables.begin(); it != tables.end(); it++, table++) {
+			const uint64_t offset = file.size();
+			const uint32_t numRows = it->second.rowNumbers.size();
+			char * entry = &file[headerSize + ((uint64_t)table * tableEntrySize)];
+			memcpy(entry, &it->second.bytesPerRow, sizeof(uint32_t));
+			memcpy(entry + 4, &numRows, sizeof(uint32_t));
+			memcpy(entry + 8, &offset, sizeof(uint64_t));
+			file.insert(file.end(), it->second.rows.begin(), it->second.rows.end());
+		}
+
+		std::ofstream dictionary(path.c_str(), (std::ofstream::out | std::ofstream::binary | std::ofstream::trunc));
+		dictionary.write(file.data(), file.size());
+		dictionary.close();
+		return !dictionary.fail();
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return "icon " + name + " of " + path;
+	}
+
+
+	// Every row's number, both as it is collected and in the file, which finish() assembles in memory. As many
+	// distinct rows as there can be, each held in its table, as a key in the table's hash map and again in the file
+	uint64_t bytesRetained(const std::vector<uint32_t> & iconWidths, const std::vector<uint32_t> & iconHeights) const {
+		std::map<uint32_t, uint64_t> tableRows;
+		const uint64_t numRows = rowsInTables(iconWidths, iconHeights, tableRows);
+		uint64_t numBytes = headerSize + ((uint64_t)iconWidths.size() * (tableEntrySize + indexEntrySize + (3 * sizeof(uint32_t)) + sizeof(uint64_t))) +
+				(numRows * 2 * sizeof(uint32_t));
+		for(std::map<uint32_t, uint64_t>::iterator it = tableRows.begin(); it != tableRows.end(); it++) {
+			// Keys longer than a std::string holds in place have a heap allocation of their own
+			const uint64_t keyBytes = (it->first < 16) ? 0 : it->first + 1;
+			numBytes += maxDistinctRows(it->first, it->second) * ((2 * (uint64_t)it->first) + keyBytes + rowEntryBytes);
+		}
+		return numBytes;
+	}
+
+
+	// Number of rows in all the icons
+	uint64_t numIconRows() const {
+		return iconRows;
+	}
+
+
+	// Number of distinct rows stored in the dictionary
+	uint64_t numDistinctRows() const {
+		uint64_t distinct = 0;
+		for(std::map<uint32_t, rowTable>::const_iterator it = tables.begin(); it != tables.end(); it++) {
+			distinct += it->second.rowNumbers.size();
+		}
+		return distinct;
+	}
+
+};
+#endif
@@ -0,0 +1,601 @@
+//============================================================================
+// Name			: Sheet Buffer (SheetBuffer.h)
+// Description 	: Holds a band of consecutive rows of the source bitmap's pixel
+//				: array, top row first, without padding bytes and with the
+//				: pixels normalised so that 0 is black and 1 is white
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _SHEET_BUFFER_LIB_H
+#define _SHEET_BUFFER_LIB_H
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+// Class for reading all, or just a band of, the rows of a one-bit-per-pixel bitmap into memory.
+// When the band is as tall as the image the whole sheet is read once and stays resident.
+class SheetBuffer {
+
+public:
+	// Enumerator for the method used to read the pixel array from the file
+	enum readMethod_t {
+		READ_IFSTREAM,		// seek to and read each row through the ifstream used for the headers
+		READ_MMAP,			// copy rows out of a read-only mapping of the whole file
+		READ_SEQUENTIAL,	// double-buffered pread() of large chunks, with posix_fadvise() hints so the page cache is not kept
+		READ_DIRECT,		// as READ_SEQUENTIAL but with O_DIRECT, bypassing the page cache entirely
+		READ_STREAM			// one pass through a stream that cannot seek, such as a pipe. The whole sheet must fit in the buffer.
+	};
+
+private:
+	std::istream & bitmapFile;
+	const uint32_t bmpDataOffset;
+	const uint32_t imageWidth;
+	const uint32_t imageHeight;
+	const unsigned int bytesInImageRow;		// bytes per row without padding
+	const unsigned int bytesInBitMapRow;	// bytes per row in the file including multiple-of-4 padding
+	const bool invertBitMap;
+	const uint8_t paddingBitMask;			// bits of the last byte in each row that lie beyond the image width
+	uint8_t * data;
+	uint64_t mappedBytes;					// size of the mapping when data came from mmap(), otherwise 0
+	unsigned int capacity;					// maximum number of rows held at once
+	unsigned int firstResident;				// image row held at the start of data
+	unsigned int numResident;				// number of rows currently held
+	unsigned int failed;					// image row on which the last read failed
+	readMethod_t method;
+	int fd;									// file descriptor used by every method except READ_IFSTREAM
+	const uint8_t * fileMapping;			// whole file, for READ_MMAP
+	uint64_t fileMappingBytes;
+	uint8_t * chunkBuffers[2];				// aligned read buffers for READ_SEQUENTIAL, READ_DIRECT and READ_STREAM
+	uint64_t chunkBytes;
+	// One reader thread lives as long as the chunk buffers, reading a chunk at a time when asked
+	std::thread readerThread;
+	std::mutex readerLock;
+	std::condition_variable readerWake;
+	bool readRequested;
+	bool readDone;
+	bool readerStopping;
+	uint8_t * requestedBuffer;
+	uint64_t requestedBytes;
+	uint64_t requestedOffset;
+	ssize_t readResult;
+	uint64_t streamPosition;				// offset within the file of the next byte to be read, for READ_STREAM
+	std::chrono::steady_clock::duration timeReading;
+
+	SheetBuffer(const SheetBuffer &);
+	SheetBuffer & operator=(const SheetBuffer &);
+
+	// Buffers of at least this size are mapped directly and marked as candidates for transparent
+	// huge pages, which cuts TLB misses when working through multi-megabyte sheets
+	static const uint64_t hugePageSize = 2 * 1024 * 1024;
+	// O_DIRECT transfers must start, end and land on multiples of the logical block size.
+	// 4096 satisfies every block size in common use.
+	static const uint64_t directAlignment = 4096;
+
+
+	// Large buffers are rounded up to a whole number of huge pages and mapped directly so that the kernel
+	// can back them with huge pages. The pages are not touched here but by the first load().
+	void allocate(const uint64_t numBytes) {
+#ifdef MADV_HUGEPAGE
+		if(numBytes >= hugePageSize) {
+			const uint64_t roundedBytes = allocationBytes(numBytes);
+			void * mapping = mmap(NULL, roundedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if(mapping != MAP_FAILED) {
+				madvise(mapping, roundedBytes, MADV_HUGEPAGE);
+				data = (uint8_t *)mapping;
+				mappedBytes = roundedBytes;
+				return;
+			}
+		}
+#endif
+		data = new uint8_t[numBytes];
+		mappedBytes = 0;
+	}
+
+
+	void release() {
+		if(mappedBytes != 0) {
+			munmap(data, mappedBytes);
+		}
+		else {
+			delete[] data;
+		}
+		data = NULL;
+		mappedBytes = 0;
+	}
+
+
+	bool allocateChunkBuffers() {
+		chunkBytes = chunkBytesFor((uint64_t)capacity * bytesInImageRow);
+		for(unsigned int i = 0; i < 2; i++) {
+			void * buffer = NULL;
+			if(posix_memalign(&buffer, directAlignment, chunkBytes) != 0) {
+				return false;
+			}
+			chunkBuffers[i] = (uint8_t *)buffer;
+		}
+		readRequested = false;
+		readDone = false;
+		readerStopping = false;
+		readerThread = std::thread(&SheetBuffer::readChunks, this);
+		return true;
+	}
+
+
+	// Body of the reader thread. Waits for each request from startRead() and reads the chunk
+	void readChunks() {
+		std::unique_lock<std::mutex> lock(readerLock);
+		while(true) {
+			readerWake.wait(lock, [this] { return readRequested || readerStopping; });
+			if(readerStopping) {
+				return;
+			}
+			readRequested = false;
+			lock.unlock();
+			const ssize_t result = readChunk(requestedBuffer, requestedBytes, requestedOffset);
+			lock.lock();
+			readResult = result;
+			readDone = true;
+			readerWake.notify_all();
+		}
+	}
+
+
+	// Asks the reader thread to read a chunk, which waitForRead() then collects. One read at a time
+	void startRead(uint8_t * dest, uint64_t numBytes, uint64_t offset) {
+		std::lock_guard<std::mutex> lock(readerLock);
+		requestedBuffer = dest;
+		requestedBytes = numBytes;
+		requestedOffset = offset;
+		readDone = false;
+		readRequested = true;
+		readerWake.notify_all();
+	}
+
+
+	ssize_t waitForRead() {
+		std::unique_lock<std::mutex> lock(readerLock);
+		readerWake.wait(lock, [this] { return readDone; });
+		return readResult;
+	}
+
+
+	void stopReaderThread() {
+		if(!readerThread.joinable()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(readerLock);
+			readerStopping = true;
+			readerWake.notify_all();
+		}
+		readerThread.join();
+	}
+
+
+	void closeReader() {
+		stopReaderThread();
+		if(fileMapping != NULL) {
+			munmap((void *)fileMapping, fileMappingBytes);
+			fileMapping = NULL;
+		}
+		for(unsigned int i = 0; i < 2; i++) {
+			free(chunkBuffers[i]);
+			chunkBuffers[i] = NULL;
+		}
+		chunkBytes = 0;
+		if(fd >= 0) {
+			close(fd);
+			fd = -1;
+		}
+		method = READ_IFSTREAM;
+	}
+
+
+	// Offset within the file of the first byte of an image row (image rows count from the top)
+	uint64_t fileOffsetOfRow(unsigned int imageRow) const {
+		return bmpDataOffset + ((uint64_t)(imageHeight - 1 - imageRow) * bytesInBitMapRow);
+	}
+
+
+	// Copies bytes of a row from the file into the buffer, inverting them if the colour table requires it
+	// and setting the padding bits beyond the image width if the copy reaches the end of the row
+	void normaliseInto(uint8_t * dest, const uint8_t * src, unsigned int numBytes, bool reachesEndOfRow) const {
+		if(invertBitMap) {
+			for(unsigned int i = 0; i < numBytes; i++) {
+				dest[i] = ~(src[i]);
+			}
+		}
+		else if(dest != src) {
+			for(unsigned int i = 0; i < numBytes; i++) {
+				dest[i] = src[i];
+			}
+		}
+		if(reachesEndOfRow && numBytes != 0) {
+			dest[numBytes-1] |= paddingBitMask;
+		}
+	}
+
+
+	bool loadWithIfstream(unsigned int firstRow, unsigned int numRows) {
+		for(unsigned int i = 0; i < numRows; i++) {
+			const unsigned int currentLine = firstRow + i;
+			uint8_t * dest = data + ((uint64_t)i * bytesInImageRow);
+			bitmapFile.seekg(fileOffsetOfRow(currentLine));
+			bitmapFile.read((char *)dest, bytesInImageRow);
+			if(bitmapFile.gcount() != bytesInImageRow) {
+				failed = currentLine;
+				return false;
+			}
+			normaliseInto(dest, dest, bytesInImageRow, true);
+		}
+		return true;
+	}
+
+
+	bool loadWithMmap(unsigned int firstRow, unsigned int numRows) {
+		for(unsigned int i = 0; i < numRows; i++) {
+			const uint64_t offset = fileOffsetOfRow(firstRow + i);
+			if(offset + bytesInImageRow > fileMappingBytes) {
+				failed = firstRow + i;
+				return false;
+			}
+			normaliseInto(data + ((uint64_t)i * bytesInImageRow), fileMapping + offset, bytesInImageRow, true);
+		}
+		// The mapped pages have been copied and will not be looked at again
+		const uint64_t pageSize = sysconf(_SC_PAGESIZE);
+		const uint64_t firstPage = (fileOffsetOfRow(firstRow + numRows - 1) / pageSize) * pageSize;
+		const uint64_t endOfBand = fileOffsetOfRow(firstRow) + bytesInImageRow;
+		madvise((void *)(fileMapping + firstPage), endOfBand - firstPage, MADV_DONTNEED);
+		return true;
+	}
+
+
+	// Reads up to numBytes from the file, retrying short reads. Returns the number of bytes read, or -1
+	ssize_t readChunk(uint8_t * dest, uint64_t numBytes, uint64_t offset) {
+		if(method == READ_STREAM) {
+			// A stream can only be read in order
+			if(offset != streamPosition) {
+				return -1;
+			}
+			bitmapFile.read((char *)dest, numBytes);
+			streamPosition += bitmapFile.gcount();
+			return bitmapFile.gcount();
+		}
+		uint64_t total = 0;
+		while(total < numBytes) {
+			const ssize_t result = pread(fd, dest + total, numBytes - total, offset + total);
+			if(result < 0) {
+				return -1;
+			}
+			if(result == 0) {
+				break;
+			}
+			total += result;
+		}
+		return total;
+	}
+
+
+	// Copies the rows, or parts of rows, of the band that fall within one chunk read from the file
+	void scatterChunk(unsigned int firstRow, uint64_t chunkOffset, const uint8_t * chunk, uint64_t chunkLength, uint64_t bandStart, uint64_t bandEnd) {
+		uint64_t offset = (chunkOffset > bandStart) ? chunkOffset : bandStart;
+		const uint64_t end = (chunkOffset + chunkLength < bandEnd) ? chunkOffset + chunkLength : bandEnd;
+		while(offset < end) {
+			const uint64_t rowInFile = (offset - bmpDataOffset) / bytesInBitMapRow;
+			const unsigned int byteInRow = (offset - bmpDataOffset) % bytesInBitMapRow;
+			if(byteInRow >= bytesInImageRow) {
+				// skip the multiple-of-4 padding bytes
+				offset += bytesInBitMapRow - byteInRow;
+				continue;
+			}
+			unsigned int numBytes = bytesInImageRow - byteInRow;
+			if(offset + numBytes > end) {
+				numBytes = end - offset;
+			}
+			const unsigned int imageRow = imageHeight - 1 - rowInFile;
+			normaliseInto(data + ((uint64_t)(imageRow - firstRow) * bytesInImageRow) + byteInRow, chunk + (offset - chunkOffset), numBytes, byteInRow + numBytes == bytesInImageRow);
+			offset += numBytes;
+		}
+	}
+
+
+	// The rows of a band are contiguous in the file, bottom row first. They are read in large chunks
+	// into two alternating buffers by the reader thread, so that the read of the next chunk overlaps the
+	// normalisation of the current one. For a stream from a decompressor the decompression itself also runs alongside, in
+	// the decompressor's own process.
+	bool loadInChunks(unsigned int firstRow, unsigned int numRows) {
+		const uint64_t bandStart = fileOffsetOfRow(firstRow + numRows - 1);
+		const uint64_t bandEnd = fileOffsetOfRow(firstRow) + bytesInImageRow;
+		const uint64_t alignment = (method == READ_DIRECT) ? directAlignment : 1;
+		const uint64_t readEnd = ((bandEnd + alignment - 1) / alignment) * alignment;
+		uint64_t nextOffset = (bandStart / alignment) * alignment;
+		unsigned int current = 0;
+		uint64_t currentOffset = nextOffset;
+		uint64_t requested = (readEnd - nextOffset < chunkBytes) ? readEnd - nextOffset : chunkBytes;
+		startRead(chunkBuffers[current], requested, nextOffset);
+		nextOffset += requested;
+		while(true) {
+			const ssize_t bytesRead = waitForRead();
+			// Reads rounded up past the end of the file come back short, which only matters if they stop short of the band
+			const uint64_t bytesNeeded = ((bandEnd < currentOffset + requested) ? bandEnd : currentOffset + requested) - currentOffset;
+			if(bytesRead < 0 || (uint64_t)bytesRead < bytesNeeded) {
+				failed = firstRow;
+				return false;
+			}
+			const uint64_t chunkOffset = currentOffset;
+			const unsigned int chunk = current;
+			const bool moreToRead = nextOffset < readEnd;
+			if(moreToRead) {
+				current ^= 1;
+				currentOffset = nextOffset;
+				requested = (readEnd - nextOffset < chunkBytes) ? readEnd - nextOffset : chunkBytes;
+				startRead(chunkBuffers[current], requested, nextOffset);
+				nextOffset += requested;
+			}
+			scatterChunk(firstRow, chunkOffset, chunkBuffers[chunk], bytesRead, bandStart, bandEnd);
+			if(!moreToRead) {
+				break;
+			}
+		}
+		if(method == READ_SEQUENTIAL) {
+			// The band has been copied, so its pages need not stay in the page cache
+			posix_fadvise(fd, bandStart, bandEnd - bandStart, POSIX_FADV_DONTNEED);
+		}
+		return true;
+	}
+
+public:
+	// Constructor
+	SheetBuffer(std::istream & file, uint32_t dataOffset, uint32_t width, uint32_t height, unsigned int rowBytes, unsigned int paddedRowBytes, bool invert, unsigned int capacityRows) :
+		bitmapFile(file), bmpDataOffset(dataOffset), imageWidth(width), imageHeight(height), bytesInImageRow(rowBytes), bytesInBitMapRow(paddedRowBytes),
+		invertBitMap(invert), paddingBitMask((width%8 != 0) ? (1 << (8 - (width%8))) - 1 : 0), data(NULL), mappedBytes(0), capacity(0),
+		firstResident(0), numResident(0), failed(0), method(READ_IFSTREAM), fd(-1), fileMapping(NULL), fileMappingBytes(0), chunkBytes(0),
+		readRequested(false), readDone(false), readerStopping(false), requestedBuffer(NULL), requestedBytes(0), requestedOffset(0), readResult(0),
+		streamPosition(0), timeReading(std::chrono::steady_clock::duration::zero()) {
+		chunkBuffers[0] = NULL;
+		chunkBuffers[1] = NULL;
+		resize(capacityRows);
+	}
+
+
+	~SheetBuffer() {
+		closeReader();
+		release();
+	}
+
+
+	// Switches to a different method of reading the pixel array. Returns false if the file could not be
+	// opened or mapped that way, in which case the buffer carries on reading through the ifstream.
+	// For READ_STREAM the path is ignored and the stream given to the constructor must be positioned
+	// at the start of the bit map data.
+	bool setReadMethod(readMethod_t readMethod, const std::string & path) {
+		closeReader();
+		if(readMethod == READ_IFSTREAM) {
+			return true;
+		}
+		if(readMethod == READ_STREAM) {
+			if(!holdsWholeSheet() || !allocateChunkBuffers()) {
+				closeReader();
+				return false;
+			}
+			streamPosition = bmpDataOffset;
+			method = readMethod;
+			return true;
+		}
+		int flags = O_RDONLY;
+		if(readMethod == READ_DIRECT) {
+#ifdef O_DIRECT
+			flags |= O_DIRECT;
+#else
+			return false;
+#endif
+		}
+		fd = open(path.c_str(), flags);
+		if(fd < 0) {
+			return false;
+		}
+		if(readMethod == READ_MMAP) {
+			struct stat fileInfo;
+			if(fstat(fd, &fileInfo) != 0 || fileInfo.st_size == 0) {
+				closeReader();
+				return false;
+			}
+			void * mapping = mmap(NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(mapping == MAP_FAILED) {
+				closeReader();
+				return false;
+			}
+			madvise(mapping, fileInfo.st_size, MADV_SEQUENTIAL);
+			fileMapping = (const uint8_t *)mapping;
+			fileMappingBytes = fileInfo.st_size;
+		}
+		else {
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+			if(!allocateChunkBuffers()) {
+				closeReader();
+				return false;
+			}
+		}
+		method = readMethod;
+		return true;
+	}
+
+
+	readMethod_t readMethod() const {
+		return method;
+	}
+
+
+	// Changes the maximum number of rows held at once. Any rows currently held are discarded,
+	// so this must not be used once a stream has been read.
+	void resize(unsigned int capacityRows) {
+		if(capacityRows > imageHeight) {
+			capacityRows = imageHeight;
+		}
+		if(capacityRows == 0) {
+			capacityRows = 1;
+		}
+		release();
+		allocate((uint64_t)capacityRows * bytesInImageRow);
+		capacity = capacityRows;
+		firstResident = 0;
+		numResident = 0;
+	}
+
+
+	unsigned int capacityRows() const {
+		return capacity;
+	}
+
+
+	// Number of bytes of memory used by the reader's chunk buffers, which are sized when the reader is chosen
+	uint64_t readerBytes() const {
+		return 2 * chunkBytes;
+	}
+
+
+	// Number of bytes of memory used by the buffer, including any rounding up to whole huge pages
+	uint64_t sizeInBytes() const {
+		return (mappedBytes != 0) ? mappedBytes : (uint64_t)capacity * bytesInImageRow;
+	}
+
+
+	// Number of bytes of memory that a buffer of numBytes will use once allocated
+	static uint64_t allocationBytes(const uint64_t numBytes) {
+#ifdef MADV_HUGEPAGE
+		if(numBytes >= hugePageSize) {
+			return ((numBytes + hugePageSize - 1) / hugePageSize) * hugePageSize;
+		}
+#endif
+		return numBytes;
+	}
+
+
+	// Size of each of the two chunk buffers the chunked readers use for a band of bandBytes: a quarter of the
+	// band, between 64 KiB and 1 MiB
+	static uint64_t chunkBytesFor(const uint64_t bandBytes) {
+		uint64_t numBytes = (bandBytes / 4 / directAlignment) * directAlignment;
+		numBytes = (numBytes < 64 * 1024) ? 64 * 1024 : numBytes;
+		return (numBytes > 1024 * 1024) ? 1024 * 1024 : numBytes;
+	}
+
+
+	// Largest number of rows of rowBytes each whose buffer, once allocated, fits within numBytes
+	static uint64_t rowsWithin(const uint64_t numBytes, const uint64_t rowBytes) {
+		uint64_t rows = numBytes / rowBytes;
+		if(allocationBytes(rows * rowBytes) > numBytes) {
+			rows = ((numBytes / hugePageSize) * hugePageSize) / rowBytes;
+		}
+		return rows;
+	}
+
+
+	// Is the whole of the image held in memory?
+	bool holdsWholeSheet() const {
+		return capacity == imageHeight;
+	}
+
+
+	// Are all rows from firstRow to lastRow inclusive currently held in memory?
+	bool holds(unsigned int firstRow, unsigned int lastRow) const {
+		return (firstRow >= firstResident) && (lastRow < firstResident + numResident);
+	}
+
+
+	// Image row on which the most recent call to load() failed
+	unsigned int failedRow() const {
+		return failed;
+	}
+
+
+	// Total time spent in load() reading and normalising rows, in milliseconds
+	uint64_t millisecondsReading() const {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(timeReading).count();
+	}
+
+
+	// Makes image rows firstRow to firstRow+numRows-1 resident, reading them from the file if
+	// they are not already held. numRows must not exceed capacityRows().
+	bool load(unsigned int firstRow, unsigned int numRows) {
+		if(numRows > capacity || firstRow + numRows > imageHeight) {
+			failed = firstRow;
+			return false;
+		}
+		if(numRows == 0 || holds(firstRow, firstRow + numRows - 1)) {
+			return true;
+		}
+		numResident = 0;
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool success = false;
+		switch(method) {
+		case READ_MMAP:
+			success = loadWithMmap(firstRow, numRows);
+			break;
+		case READ_SEQUENTIAL:
+		case READ_DIRECT:
+		case READ_STREAM:
+			success = loadInChunks(firstRow, numRows);
+			break;
+		default:
+			success = loadWithIfstream(firstRow, numRows);
+			break;
+		}
+		timeReading += std::chrono::steady_clock::now() - start;
+		if(!success) {
+			return false;
+		}
+		firstResident = firstRow;
+		numResident = numRows;
+		return true;
+	}
+
+
+	// Is the buffer backed by an anonymous mapping with a huge page hint?
+	bool usesHugePages() const {
+		return mappedBytes != 0;
+	}
+
+
+	// Pointer to the start of an image row. The row must be resident.
+	const uint8_t * row(unsigned int imageRow) const {
+		return data + ((uint64_t)(imageRow - firstResident) * bytesInImageRow);
+	}
+
+
+	// As above, for filtering the resident rows in place. They stay filtered until they are read again.
+	uint8_t * row(unsigned int imageRow) {
+		return data + ((uint64_t)(imageRow - firstResident) * bytesInImageRow);
+	}
+
+};
+#endif
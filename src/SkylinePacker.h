@@ -0,0 +1,198 @@
+//============================================================================
+// Name			: Skyline Packer (SkylinePacker.h)
+// Description 	: Packs rectangles into a single rectangle of close to minimum
+//				: area using the skyline bottom-left heuristic
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _SKYLINE_PACKER_LIB_H
+#define _SKYLINE_PACKER_LIB_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+// Class for packing rectangles into an atlas. The top edge of the packed area is tracked as a
+// skyline of horizontal segments and each rectangle, tallest first, is placed where its bottom
+// edge ends up highest in the atlas (lowest y). Several atlas widths around the square root of the
+// total area are tried and the packing with the smallest area is kept.
+class SkylinePacker {
+
+private:
+	struct segment {
+		uint32_t x;
+		uint32_t y;			// top of the free space above this segment
+		uint32_t width;
+	};
+
+	const uint32_t alignment;
+	std::vector<uint32_t> positionsX;
+	std::vector<uint32_t> positionsY;
+	uint32_t packedWidth;
+	uint32_t packedHeight;
+
+	// Packs every rectangle, in the given order, into an atlas of fixed width. Returns the height used.
+	uint32_t packIntoWidth(uint32_t atlasWidth, const std::vector<uint32_t> & widths, const std::vector<uint32_t> & heights,
+			const std::vector<uint32_t> & order, std::vector<uint32_t> & x, std::vector<uint32_t> & y) const {
+		std::vector<segment> skyline(1);
+		skyline[0].x = 0;
+		skyline[0].y = 0;
+		skyline[0].width = atlasWidth;
+		uint32_t usedHeight = 0;
+		for(std::vector<uint32_t>::const_iterator it = order.begin(); it != order.end(); it++) {
+			const uint32_t width = alignedWidth(widths[*it]);
+			const uint32_t height = heights[*it];
+			// Find the segment at which the rectangle's bottom edge is highest, preferring the leftmost
+			unsigned int bestSegment = 0;
+			uint32_t bestY = UINT32_MAX;
+			for(unsigned int i = 0; i < skyline.size() && skyline[i].x + width <= atlasWidth; i++) {
+				uint32_t top = 0;
+				uint32_t remaining = width;
+				for(unsigned int j = i; remaining > 0; j++) {
+					top = std::max(top, skyline[j].y);
+					remaining -= std::min(remaining, skyline[j].width);
+				}
+				if(top < bestY) {
+					bestY = top;
+					bestSegment = i;
+				}
+			}
+			x[*it] = skyline[bestSegment].x;
+			y[*it] = bestY;
+			usedHeight = std::max(usedHeight, bestY + height);
+
+			// Raise the skyline under the rectangle, trimming or removing the segments it covers
+			segment raised;
+			raised.x = skyline[bestSegment].x;
+			raised.y = bestY + height;
+			raised.width = width;
+			unsigned int next = bestSegment;
+			uint32_t covered = 0;
+			while(next < skyline.size() && covered + skyline[next].width <= width) {
+				covered += skyline[next].width;
+				next++;
+			}
+			if(next < skyline.size() && covered < width) {
+				skyline[next].x += width - covered;
+				skyline[next].width -= width - covered;
+			}
+			skyline.erase(skyline.begin() + bestSegment, skyline.begin() + next);
+			skyline.insert(skyline.begin() + bestSegment, raised);
+			// Join neighbouring segments at the same height so the skyline stays short
+			if(bestSegment + 1 < skyline.size() && skyline[bestSegment + 1].y == raised.y) {
+				skyline[bestSegment].width += skyline[bestSegment + 1].width;
+				skyline.erase(skyline.begin() + bestSegment + 1);
+			}
+			if(bestSegment > 0 && skyline[bestSegment - 1].y == raised.y) {
+				skyline[bestSegment - 1].width += skyline[bestSegment].width;
+				skyline.erase(skyline.begin() + bestSegment);
+			}
+		}
+		return usedHeight;
+	}
+
+
+	struct tallestFirst {
+		const std::vector<uint32_t> & widths;
+		const std::vector<uint32_t> & heights;
+		tallestFirst(const std::vector<uint32_t> & w, const std::vector<uint32_t> & h) : widths(w), heights(h) {
+			//
+		}
+		bool operator()(uint32_t a, uint32_t b) const {
+			return (heights[a] != heights[b]) ? (heights[a] > heights[b]) : (widths[a] > widths[b]);
+		}
+	};
+
+public:
+	// Constructor. With an alignment of 8 every rectangle starts on a byte boundary of a one-bit-per-pixel atlas
+	SkylinePacker(uint32_t xAlignment) : alignment(xAlignment ? xAlignment : 1), packedWidth(0), packedHeight(0) {
+		//
+	}
+
+
+	// Width a rectangle takes up in the atlas once rounded up to the alignment
+	uint32_t alignedWidth(uint32_t width) const {
+		return ((width + alignment - 1) / alignment) * alignment;
+	}
+
+
+	// Packs the rectangles. Their positions are then available from x() and y()
+	void pack(const std::vector<uint32_t> & widths, const std::vector<uint32_t> & heights) {
+		const uint32_t numRects = widths.size();
+		std::vector<uint32_t> order(numRects);
+		uint64_t totalArea = 0;
+		uint32_t widest = 0;
+		for(uint32_t i = 0; i < numRects; i++) {
+			order[i] = i;
+			totalArea += (uint64_t)alignedWidth(widths[i]) * heights[i];
+			widest = std::max(widest, alignedWidth(widths[i]));
+		}
+		std::sort(order.begin(), order.end(), tallestFirst(widths, heights));
+
+		std::vector<uint32_t> x(numRects);
+		std::vector<uint32_t> y(numRects);
+		uint64_t bestArea = UINT64_MAX;
+		packedWidth = 0;
+		packedHeight = 0;
+		const double side = sqrt((double)totalArea);
+		for(double factor = 0.8; factor < 1.65; factor += 0.1) {
+			const uint32_t atlasWidth = std::max(widest, alignedWidth((uint32_t)(side * factor)));
+			const uint32_t atlasHeight = packIntoWidth(atlasWidth, widths, heights, order, x, y);
+			// The packed width can be less than the width tried if the rightmost space went unused
+			uint32_t usedWidth = 0;
+			for(uint32_t i = 0; i < numRects; i++) {
+				usedWidth = std::max(usedWidth, x[i] + widths[i]);
+			}
+			if((uint64_t)usedWidth * atlasHeight < bestArea) {
+				bestArea = (uint64_t)usedWidth * atlasHeight;
+				packedWidth = usedWidth;
+				packedHeight = atlasHeight;
+				positionsX.swap(x);
+				positionsY.swap(y);
+				x.resize(numRects);
+				y.resize(numRects);
+			}
+		}
+	}
+
+
+	uint32_t x(uint32_t rect) const {
+		return positionsX[rect];
+	}
+
+
+	uint32_t y(uint32_t rect) const {
+		return positionsY[rect];
+	}
+
+
+	uint32_t width() const {
+		return packedWidth;
+	}
+
+
+	uint32_t height() const {
+		return packedHeight;
+	}
+
+};
+#endif
@@ -0,0 +1,197 @@
+//============================================================================
+// Name			: Tar Sink (TarSink.h)
+// Description 	: Writes output files one after another into a single POSIX
+//				: ustar archive, either a file or standard output
+//
+// Author		: Richard Leszczynski
+// Contact		: richard@makerdyne.com
+//
+// License		: Copyright (C) 2015 Richard Leszczynski
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//============================================================================
+
+#ifndef _TAR_SINK_LIB_H
+#define _TAR_SINK_LIB_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <errno.h>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "FileSink.h"
+
+// Class for streaming files into a tar archive. The archive is only ever appended to,
+// through a large buffer, so it reaches the disk (or pipe) as one long sequential write.
+class TarSink : public FileSink {
+
+private:
+	int fd;
+	bool ownsFd;
+	bool failed;
+	const uint32_t modificationTime;
+	std::vector<char> buffer;
+	uint64_t bufferUsed;
+
+	static const unsigned int blockSize = 512;
+
+	TarSink(const TarSink &);
+	TarSink & operator=(const TarSink &);
+
+	bool flush() {
+		uint64_t written = 0;
+		while(written < bufferUsed && !failed) {
+			const ssize_t result = write(fd, &buffer[written], bufferUsed - written);
+			if(result < 0 && errno == EINTR) {
+				continue;
+			}
+			if(result <= 0) {
+				failed = true;
+			}
+			else {
+				written += result;
+			}
+		}
+		bufferUsed = 0;
+		return !failed;
+	}
+
+
+	bool append(const char * data, uint64_t numBytes) {
+		while(numBytes > 0) {
+			if(bufferUsed == buffer.size() && !flush()) {
+				return false;
+			}
+			uint64_t numToCopy = buffer.size() - bufferUsed;
+			numToCopy = (numToCopy < numBytes) ? numToCopy : numBytes;
+			memcpy(&buffer[bufferUsed], data, numToCopy);
+			bufferUsed += numToCopy;
+			data += numToCopy;
+			numBytes -= numToCopy;
+		}
+		return true;
+	}
+
+
+	// Writes a number into a header field as zero-padded octal followed by a NUL
+	static void octalField(char * field, unsigned int fieldLength, uint64_t value) {
+		for(int i = fieldLength - 2; i >= 0; i--) {
+			field[i] = '0' + (value & 7);
+			value >>= 3;
+		}
+		field[fieldLength - 1] = '\0';
+	}
+
+public:
+	// Constructor. A path of "-" writes the archive to standard output.
+	TarSink(const std::string & path) : fd(-1), ownsFd(false), failed(false), modificationTime(time(NULL)), buffer(1024 * 1024), bufferUsed(0) {
+		if(path == "-") {
+			fd = STDOUT_FILENO;
+		}
+		else {
+			fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			ownsFd = true;
+		}
+		failed = (fd < 0);
+	}
+
+
+	~TarSink() {
+		if(ownsFd && fd >= 0) {
+			close(fd);
+		}
+	}
+
+
+	bool isOpen() const {
+		return fd >= 0;
+	}
+
+
+	bool writeFile(const std::string & name, const char * data, uint64_t numBytes) {
+		// ustar header. Names longer than 100 characters are split at a '/' into the prefix field
+		char header[blockSize];
+		memset(header, 0, blockSize);
+		std::string prefix;
+		std::string memberName = name;
+		if(memberName.size() > 100) {
+			const std::string::size_type split = memberName.rfind('/', 155);
+			if(split == std::string::npos || memberName.size() - split - 1 > 100) {
+				failed = true;
+				return false;
+			}
+			prefix = memberName.substr(0, split);
+			memberName = memberName.substr(split + 1);
+		}
+		memcpy(header, memberName.data(), memberName.size());			// name
+		octalField(header + 100, 8, 0644);								// mode
+		octalField(header + 108, 8, 0);									// uid
+		octalField(header + 116, 8, 0);									// gid
+		octalField(header + 124, 12, numBytes);							// size
+		octalField(header + 136, 12, modificationTime);					// mtime
+		memset(header + 148, ' ', 8);									// checksum is calculated with its own field as spaces
+		header[156] = '0';												// typeflag: regular file
+		memcpy(header + 257, "ustar", 6);								// magic
+		memcpy(header + 263, "00", 2);									// version
+		memcpy(header + 345, prefix.data(), prefix.size());				// prefix
+		unsigned int checksum = 0;
+		for(unsigned int i = 0; i < blockSize; i++) {
+			checksum += (unsigned char)header[i];
+		}
+		octalField(header + 148, 7, checksum);
+		header[155] = ' ';
+		if(!append(header, blockSize) || !append(data, numBytes)) {
+			return false;
+		}
+		// File data is padded out to a whole number of blocks
+		const unsigned int numPaddingBytes = (blockSize - (numBytes % blockSize)) % blockSize;
+		char padding[blockSize];
+		memset(padding, 0, blockSize);
+		return append(padding, numPaddingBytes);
+	}
+
+
+	// Ends the archive with two empty blocks
+	bool finish() {
+		char endOfArchive[2 * blockSize];
+		memset(endOfArchive, 0, sizeof(endOfArchive));
+		if(!append(endOfArchive, sizeof(endOfArchive)) || !flush()) {
+			return false;
+		}
+		if(ownsFd) {
+			failed = (close(fd) != 0);
+			fd = -1;
+		}
+		return !failed;
+	}
+
+
+	std::string describe(const std::string & name) const {
+		return name;
+	}
+
+
+	uint64_t bufferBytes() const {
+		return buffer.size();
+	}
+
+};
+#endif